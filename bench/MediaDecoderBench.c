@@ -0,0 +1,906 @@
+#include "MediaDecoder.h"
+
+#include "ImageResizer.h"
+#include "SampleConverter.h"
+#include "SoundResampler.h"
+#include <libavcodec/avcodec.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/common.h>
+#include <libavutil/cpu.h>
+#include <libavutil/pixfmt.h>
+#include <libavutil/samplefmt.h>
+#include <libavutil/time.h>
+#include <libswresample/swresample.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#define BENCH_SAMPLE_RATE 48000
+#define BENCH_FRAME_SAMPLES 1024
+#define BENCH_AUDIO_SECONDS 60
+#define BENCH_PI 3.14159265358979323846
+#define BENCH_CONVERT_CHANNELS 8
+// timestamp is drawn as 8x8 black or white blocks, one per bit
+#define BENCH_LIVE_WIDTH 256
+#define BENCH_LIVE_HEIGHT 128
+#define BENCH_LIVE_FPS 30
+#define BENCH_RESIZE_ITERATIONS 50
+#define BENCH_SEQUENCE_WIDTH 320
+#define BENCH_SEQUENCE_HEIGHT 240
+#define BENCH_SEQUENCE_FRAMES 32
+#define BENCH_TENSOR_SIZE 224
+
+typedef int (*BenchFunc)(int argc, char** argv);
+
+typedef struct
+{
+	const char* name;
+	const char* usage;
+	BenchFunc func;
+} BenchCommand;
+
+static double Bench_Seconds(int64_t start)
+{
+	return (av_gettime_relative() - start) / 1000000.0;
+}
+
+/// @brief Fill planar float buffer with a sweep, so that resampling filter has content across whole spectrum
+static void Bench_FillSweep(float** planes, int channelCount, int sampleCount, int sampleRate)
+{
+	for (int i = 0; i < sampleCount; i++)
+	{
+		// one second sweep from 100 Hz to 10 kHz, repeated
+		double t = (double)(i % sampleRate) / sampleRate;
+		float value = (float)(0.5 * sin(BENCH_PI * (200.0 + 9900.0 * t) * t));
+		for (int c = 0; c < channelCount; c++)
+			planes[c][i] = value;
+	}
+}
+
+static int Bench_Resample(int argc, char** argv)
+{
+	int outSampleRate = argc > 0 ? atoi(argv[0]) : 44100;
+	static const char* names[] = {"default", "preview", "realtime", "mastering"};
+
+	int totalSamples = BENCH_SAMPLE_RATE * BENCH_AUDIO_SECONDS;
+	float* left = malloc(sizeof(float) * totalSamples);
+	float* right = malloc(sizeof(float) * totalSamples);
+	int outCapacity = BENCH_FRAME_SAMPLES * 4;
+	float* out = malloc(sizeof(float) * 2 * outCapacity);
+	if (!left || !right || !out)
+		return 1;
+
+	float* planes[] = {left, right};
+	Bench_FillSweep(planes, 2, totalSamples, BENCH_SAMPLE_RATE);
+
+	printf("resample %d Hz -> %d Hz stereo, %d s of audio\n", BENCH_SAMPLE_RATE, outSampleRate, BENCH_AUDIO_SECONDS);
+	printf("%-10s %14s %10s\n", "quality", "ms per second", "delay ms");
+	for (int quality = RESAMPLE_QUALITY_DEFAULT; quality <= RESAMPLE_QUALITY_MASTERING; quality++)
+	{
+		SoundResamplerContext* resampler = SoundResampler_CreateContext();
+		SoundResampler_SetQuality(resampler, quality);
+		if (!SoundResampler_SetParameters(
+				resampler, BENCH_SAMPLE_RATE, CHANNEL_LAYOUT_STEREO, AV_SAMPLE_FMT_FLTP | 0x10000, outSampleRate,
+				CHANNEL_LAYOUT_STEREO, SAMPLE_FORMAT_FLOAT
+			))
+		{
+			fprintf(stderr, "could not create resampler for %s\n", names[quality]);
+			SoundResampler_ReleaseContext(&resampler);
+			continue;
+		}
+
+		// samples held back by filter after first frame is what playback waits for before first output
+		int64_t delay = -1;
+		uint8_t* outData = (uint8_t*)out;
+		int64_t start = av_gettime_relative();
+		for (int offset = 0; offset + BENCH_FRAME_SAMPLES <= totalSamples; offset += BENCH_FRAME_SAMPLES)
+		{
+			const uint8_t* in[] = {(const uint8_t*)(left + offset), (const uint8_t*)(right + offset)};
+			SoundResampler_Resample(resampler, in, BENCH_FRAME_SAMPLES, &outData, outCapacity);
+			if (delay < 0)
+				delay = SoundResampler_GetDelay(resampler);
+		}
+		double seconds = Bench_Seconds(start);
+
+		printf(
+			"%-10s %14.3f %10.2f\n", names[quality], seconds * 1000.0 / BENCH_AUDIO_SECONDS,
+			delay * 1000.0 / outSampleRate
+		);
+		SoundResampler_ReleaseContext(&resampler);
+	}
+
+	free(out);
+	free(right);
+	free(left);
+	return 0;
+}
+
+static void Bench_SetPlanes(uint8_t** planes, uint8_t* buffer, enum AVSampleFormat format, int channelCount)
+{
+	size_t planeSize = (size_t)av_get_bytes_per_sample(format) * BENCH_FRAME_SAMPLES;
+	for (int c = 0; c < channelCount; c++)
+		planes[c] = av_sample_fmt_is_planar(format) ? buffer + c * planeSize : buffer;
+}
+
+static int Bench_Convert(int argc, char** argv)
+{
+	static const enum AVSampleFormat formats[][2] = {
+		{AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_FLT}, {AV_SAMPLE_FMT_S32P, AV_SAMPLE_FMT_FLT},
+		{AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_FLT}, {AV_SAMPLE_FMT_DBLP, AV_SAMPLE_FMT_FLT},
+		{AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_FLT}, {AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_S16},
+		{AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_S32}, {AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_DBL},
+	};
+	int channelCounts[] = {2, BENCH_CONVERT_CHANNELS};
+	int channelSetCount = 2;
+	if (argc > 0)
+	{
+		channelCounts[0] = atoi(argv[0]);
+		channelSetCount = 1;
+		if (channelCounts[0] < 1 || channelCounts[0] > BENCH_CONVERT_CHANNELS)
+		{
+			fprintf(stderr, "channelCount has to be 1 to %d\n", BENCH_CONVERT_CHANNELS);
+			return 1;
+		}
+	}
+
+	size_t bufferSize = sizeof(double) * BENCH_FRAME_SAMPLES * BENCH_CONVERT_CHANNELS;
+	float* sweep = malloc(sizeof(float) * BENCH_FRAME_SAMPLES * BENCH_CONVERT_CHANNELS);
+	uint8_t* inBuffer = malloc(bufferSize);
+	uint8_t* kernelBuffer = malloc(bufferSize);
+	uint8_t* swrBuffer = malloc(bufferSize);
+	if (!sweep || !inBuffer || !kernelBuffer || !swrBuffer)
+		return 1;
+
+	float* sweepPlanes[BENCH_CONVERT_CHANNELS];
+	for (int c = 0; c < BENCH_CONVERT_CHANNELS; c++)
+		sweepPlanes[c] = sweep + c * BENCH_FRAME_SAMPLES;
+	Bench_FillSweep(sweepPlanes, BENCH_CONVERT_CHANNELS, BENCH_FRAME_SAMPLES, BENCH_SAMPLE_RATE);
+
+	// same block is converted over and over, so that only conversion is timed
+	int blockCount = BENCH_SAMPLE_RATE * BENCH_AUDIO_SECONDS / BENCH_FRAME_SAMPLES;
+	printf(
+		"convert without rate or layout change, %d s of audio in blocks of %d\n", BENCH_AUDIO_SECONDS,
+		BENCH_FRAME_SAMPLES
+	);
+	printf(
+		"%-8s %-5s %-5s %12s %12s %8s %6s\n", "channels", "in", "out", "kernel ms/s", "swr ms/s", "speedup", "match"
+	);
+	for (int set = 0; set < channelSetCount; set++)
+	{
+		int channelCount = channelCounts[set];
+		for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+		{
+			enum AVSampleFormat inFormat = formats[f][0];
+			enum AVSampleFormat outFormat = formats[f][1];
+			uint8_t* in[BENCH_CONVERT_CHANNELS];
+			uint8_t* kernelOut[BENCH_CONVERT_CHANNELS];
+			uint8_t* swrOut[BENCH_CONVERT_CHANNELS];
+			Bench_SetPlanes(in, inBuffer, inFormat, channelCount);
+			Bench_SetPlanes(kernelOut, kernelBuffer, outFormat, channelCount);
+			Bench_SetPlanes(swrOut, swrBuffer, outFormat, channelCount);
+			SampleConverter_Find(AV_SAMPLE_FMT_FLTP, inFormat)(
+				(const uint8_t* const*)sweepPlanes, 0, in, 0, BENCH_FRAME_SAMPLES, channelCount
+			);
+
+			AVChannelLayout layout;
+			av_channel_layout_default(&layout, channelCount);
+			struct SwrContext* swr = NULL;
+			if (swr_alloc_set_opts2(
+					&swr, &layout, outFormat, BENCH_SAMPLE_RATE, &layout, inFormat, BENCH_SAMPLE_RATE, 0, NULL
+				) < 0 ||
+				swr_init(swr) < 0)
+			{
+				fprintf(stderr, "could not create swresample context\n");
+				swr_free(&swr);
+				av_channel_layout_uninit(&layout);
+				continue;
+			}
+
+			SampleConverterFunc convert = SampleConverter_Find(inFormat, outFormat);
+			int64_t start = av_gettime_relative();
+			for (int i = 0; i < blockCount; i++)
+				convert((const uint8_t* const*)in, 0, kernelOut, 0, BENCH_FRAME_SAMPLES, channelCount);
+			double kernelSeconds = Bench_Seconds(start);
+
+			start = av_gettime_relative();
+			for (int i = 0; i < blockCount; i++)
+				swr_convert(swr, swrOut, BENCH_FRAME_SAMPLES, (const uint8_t**)in, BENCH_FRAME_SAMPLES);
+			double swrSeconds = Bench_Seconds(start);
+
+			// kernels are meant to give exactly what swresample gives
+			size_t outSize = (size_t)av_get_bytes_per_sample(outFormat) * channelCount * BENCH_FRAME_SAMPLES;
+			printf(
+				"%-8d %-5s %-5s %12.3f %12.3f %8.2f %6s\n", channelCount, av_get_sample_fmt_name(inFormat),
+				av_get_sample_fmt_name(outFormat), kernelSeconds * 1000.0 / BENCH_AUDIO_SECONDS,
+				swrSeconds * 1000.0 / BENCH_AUDIO_SECONDS, swrSeconds / kernelSeconds,
+				memcmp(kernelBuffer, swrBuffer, outSize) == 0 ? "yes" : "no"
+			);
+			swr_free(&swr);
+			av_channel_layout_uninit(&layout);
+		}
+	}
+
+	free(swrBuffer);
+	free(kernelBuffer);
+	free(inBuffer);
+	free(sweep);
+	return 0;
+}
+
+/// @brief Fill YUV 4:2:0 image with fine stripes, edges and gradients, which show differences between filters
+static void Bench_FillImage(uint8_t** planes, const int* strides, int width, int height)
+{
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int stripes = ((x / 2 + y / 3) & 1) * 60;
+			int edge = (x * 7 / width + y * 5 / height) & 1 ? 120 : 0;
+			planes[0][y * strides[0] + x] = (uint8_t)(16 + stripes + edge + (x * 40 / width));
+		}
+	}
+
+	for (int y = 0; y < height / 2; y++)
+	{
+		for (int x = 0; x < width / 2; x++)
+		{
+			planes[1][y * strides[1] + x] = (uint8_t)(x * 255 / (width / 2));
+			planes[2][y * strides[2] + x] = (uint8_t)(y * 255 / (height / 2));
+		}
+	}
+}
+
+static double Bench_Psnr(const uint8_t* a, const uint8_t* b, int width, int height)
+{
+	double sum = 0;
+	size_t count = 0;
+	for (size_t i = 0; i < (size_t)width * height * 4; i++)
+	{
+		// alpha is the same for all filters
+		if (i % 4 == 3)
+			continue;
+		double diff = (double)a[i] - b[i];
+		sum += diff * diff;
+		count++;
+	}
+
+	if (sum == 0)
+		return INFINITY;
+	return 10.0 * log10(255.0 * 255.0 / (sum / count));
+}
+
+static int Bench_ResizeOne(
+	ImageResizerContext* resizer, enum MediaDecoderScaleQuality quality, uint8_t** in, const int* inStrides,
+	int inWidth, int inHeight, uint8_t* out, int outWidth, int outHeight, double* seconds
+)
+{
+	ImageResizer_SetQuality(resizer, quality);
+	if (!ImageResizer_SetParameters(
+			resizer, inWidth, inHeight, AV_PIX_FMT_YUV420P | 0x10000, outWidth, outHeight,
+			PIXEL_FORMAT_R8G8B8A8_UINT
+		))
+	{
+		return -1;
+	}
+
+	uint8_t* outData[] = {out, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+	int outStrides[] = {outWidth * 4, 0, 0, 0, 0, 0, 0, 0};
+	int64_t start = av_gettime_relative();
+	for (int i = 0; i < BENCH_RESIZE_ITERATIONS; i++)
+		ImageResizer_Resize(resizer, (const uint8_t**)in, inStrides, outData, outStrides);
+	*seconds = Bench_Seconds(start);
+	return 0;
+}
+
+static int Bench_Resize(int argc, char** argv)
+{
+	// chroma planes are half size, so both sizes are made even
+	int inWidth = (argc > 1 ? atoi(argv[0]) : 1920) & ~1;
+	int inHeight = (argc > 1 ? atoi(argv[1]) : 1080) & ~1;
+	static const int divisors[] = {1, 2, 4, 12};
+	static const char* names[] = {"auto", "fast", "point", "bilinear", "bicubic", "area", "lanczos"};
+
+	int inStrides[] = {inWidth, inWidth / 2, inWidth / 2, 0, 0, 0, 0, 0};
+	uint8_t* inBuffer = malloc((size_t)inWidth * inHeight * 3 / 2);
+	uint8_t* reference = malloc((size_t)inWidth * inHeight * 4);
+	uint8_t* out = malloc((size_t)inWidth * inHeight * 4);
+	if (inWidth < 24 || inHeight < 24 || !inBuffer || !reference || !out)
+		return 1;
+
+	uint8_t* in[] = {
+		inBuffer, inBuffer + (size_t)inWidth * inHeight, inBuffer + (size_t)inWidth * inHeight * 5 / 4,
+		NULL, NULL, NULL, NULL, NULL
+	};
+	Bench_FillImage(in, inStrides, inWidth, inHeight);
+
+	printf(
+		"resize %dx%d yuv420p -> rgba, %d iterations, psnr against lanczos\n", inWidth, inHeight,
+		BENCH_RESIZE_ITERATIONS
+	);
+	printf("%-11s %-9s %12s %10s\n", "size", "quality", "frames/s", "psnr dB");
+	for (size_t d = 0; d < sizeof(divisors) / sizeof(divisors[0]); d++)
+	{
+		int outWidth = inWidth / divisors[d];
+		int outHeight = inHeight / divisors[d];
+		ImageResizerContext* resizer = ImageResizer_CreateContext();
+
+		double seconds;
+		if (Bench_ResizeOne(
+				resizer, SCALE_QUALITY_LANCZOS, in, inStrides, inWidth, inHeight, reference, outWidth, outHeight,
+				&seconds
+			))
+		{
+			ImageResizer_ReleaseContext(&resizer);
+			continue;
+		}
+
+		for (int quality = SCALE_QUALITY_AUTO; quality <= SCALE_QUALITY_LANCZOS; quality++)
+		{
+			if (Bench_ResizeOne(
+					resizer, quality, in, inStrides, inWidth, inHeight, out, outWidth, outHeight, &seconds
+				))
+			{
+				fprintf(stderr, "could not create resizer for %s\n", names[quality]);
+				continue;
+			}
+
+			char size[32];
+			snprintf(size, sizeof(size), "%dx%d", outWidth, outHeight);
+			printf(
+				"%-11s %-9s %12.1f %10.2f\n", size, names[quality], BENCH_RESIZE_ITERATIONS / seconds,
+				Bench_Psnr(out, reference, outWidth, outHeight)
+			);
+		}
+		ImageResizer_ReleaseContext(&resizer);
+	}
+
+	free(out);
+	free(reference);
+	free(inBuffer);
+	return 0;
+}
+
+/// @brief Decode all video frames through MediaDecoder_NextFrame, like batch jobs did before parallel decoding
+static int64_t Bench_DecodeSequential(
+	const char* url, uint32_t width, uint32_t height, enum MediaDecoderPreviewMode previewMode
+)
+{
+	MediaDecoderContext* context = MediaDecoder_Open(url);
+	if (!context)
+		return -1;
+
+	context->video.decodedWidth = width ? width : context->video.originalWidth;
+	context->video.decodedHeight = height ? height : context->video.originalHeight;
+	context->video.decodedPixelFormat = PIXEL_FORMAT_R8G8B8A8_UINT;
+	context->video.previewMode = previewMode;
+
+	int64_t frameCount = 0;
+	uint32_t streamIndex = 0;
+	while (MediaDecoder_NextFrame(context, &streamIndex) == 0)
+	{
+		if (streamIndex == context->playback.selectedVideoStream && MediaDecoder_DecodeFrame(context) == 0)
+			frameCount++;
+	}
+
+	MediaDecoder_Close(&context);
+	return frameCount;
+}
+
+static int Bench_CountFrame(void* userData, const MediaDecoderVideoInfo* video, double time)
+{
+	(void)userData;
+	(void)video;
+	(void)time;
+	return 0;
+}
+
+static int Bench_Parallel(int argc, char** argv)
+{
+	if (argc < 1)
+		return 1;
+	const char* url = argv[0];
+	uint32_t width = argc > 2 ? (uint32_t)atoi(argv[1]) : 0;
+	uint32_t height = argc > 2 ? (uint32_t)atoi(argv[2]) : 0;
+
+	int64_t start = av_gettime_relative();
+	int64_t sequentialFrames = Bench_DecodeSequential(url, width, height, PREVIEW_MODE_AUTO);
+	double sequentialSeconds = Bench_Seconds(start);
+	if (sequentialFrames < 0)
+	{
+		fprintf(stderr, "could not open %s\n", url);
+		return 1;
+	}
+
+	printf("%-12s %8s %10s %10s %8s\n", "mode", "threads", "frames", "frames/s", "speedup");
+	printf(
+		"%-12s %8d %10lld %10.1f %8.2f\n", "sequential", 1, (long long)sequentialFrames,
+		sequentialFrames / sequentialSeconds, 1.0
+	);
+
+	MediaDecoderParallelInfo info = {0};
+	info.decodedWidth = width;
+	info.decodedHeight = height;
+	info.decodedPixelFormat = PIXEL_FORMAT_R8G8B8A8_UINT;
+	info.callback = Bench_CountFrame;
+
+	// 1, 2, 4, ... threads, last run uses one thread per core
+	int coreCount = av_cpu_count();
+	for (int threadCount = 1;; threadCount *= 2)
+	{
+		if (threadCount > coreCount)
+			threadCount = coreCount;
+
+		info.threadCount = (uint32_t)threadCount;
+		start = av_gettime_relative();
+		int64_t frames = MediaDecoder_DecodeParallel(url, &info);
+		double seconds = Bench_Seconds(start);
+		if (frames < 0)
+		{
+			fprintf(stderr, "parallel decode with %d threads failed\n", threadCount);
+		}
+		else
+		{
+			printf(
+				"%-12s %8d %10lld %10.1f %8.2f\n", "parallel", threadCount, (long long)frames, frames / seconds,
+				sequentialSeconds / seconds
+			);
+		}
+
+		if (threadCount == coreCount)
+			break;
+	}
+
+	return 0;
+}
+
+static int Bench_Preview(int argc, char** argv)
+{
+	if (argc < 3)
+		return 1;
+	const char* url = argv[0];
+	uint32_t width = (uint32_t)atoi(argv[1]);
+	uint32_t height = (uint32_t)atoi(argv[2]);
+
+	static const enum MediaDecoderPreviewMode modes[] = {PREVIEW_MODE_OFF, PREVIEW_MODE_AUTO};
+	static const char* names[] = {"full", "preview"};
+	double seconds[2] = {0.0, 0.0};
+
+	printf("decode %s to %ux%u\n", url, width, height);
+	printf("%-8s %10s %10s %10s\n", "mode", "frames", "frames/s", "saving");
+	for (int i = 0; i < 2; i++)
+	{
+		int64_t start = av_gettime_relative();
+		int64_t frames = Bench_DecodeSequential(url, width, height, modes[i]);
+		seconds[i] = Bench_Seconds(start);
+		if (frames < 0)
+		{
+			fprintf(stderr, "could not open %s\n", url);
+			return 1;
+		}
+
+		// saving is decode time preview mode saves compared to full decode
+		printf(
+			"%-8s %10lld %10.1f %9.1f%%\n", names[i], (long long)frames, frames / seconds[i],
+			100.0 * (1.0 - seconds[i] / seconds[0])
+		);
+	}
+
+	return 0;
+}
+
+static int Bench_CountPacket(void* userData, const MediaDecoderPacket* packet)
+{
+	*(uint64_t*)userData += packet->size;
+	return 0;
+}
+
+/// @brief Trim by decoding every frame in range, like clips were made before MediaDecoder_ExportClip
+static int64_t Bench_DecodeClip(MediaDecoderContext* context, double startTime, double endTime)
+{
+	if (MediaDecoder_Seek(context, startTime))
+		return -1;
+
+	int64_t frameCount = 0;
+	uint32_t streamIndex = 0;
+	while (MediaDecoder_NextFrame(context, &streamIndex) == 0)
+	{
+		if (MediaDecoder_DecodeFrame(context) == 0)
+			frameCount++;
+		if (streamIndex == context->playback.selectedVideoStream && context->playback.position >= endTime)
+			break;
+	}
+	return frameCount;
+}
+
+static int Bench_Clip(int argc, char** argv)
+{
+	if (argc < 3)
+		return 1;
+	const char* url = argv[0];
+	double startTime = atof(argv[1]);
+	double endTime = atof(argv[2]);
+	const char* outUrl = argc > 3 ? argv[3] : NULL;
+
+	MediaDecoderContext* context = MediaDecoder_Open(url);
+	if (!context)
+	{
+		fprintf(stderr, "could not open %s\n", url);
+		return 1;
+	}
+	context->video.decodedWidth = context->video.originalWidth;
+	context->video.decodedHeight = context->video.originalHeight;
+	context->video.decodedPixelFormat = PIXEL_FORMAT_R8G8B8A8_UINT;
+
+	int64_t start = av_gettime_relative();
+	int64_t frames = Bench_DecodeClip(context, startTime, endTime);
+	double decodeSeconds = Bench_Seconds(start);
+	if (frames < 0)
+	{
+		fprintf(stderr, "could not seek to %.3f\n", startTime);
+		MediaDecoder_Close(&context);
+		return 1;
+	}
+
+	printf("clip %s from %.3f to %.3f\n", url, startTime, endTime);
+	printf("%-12s %10s %12s %10s %8s\n", "mode", "units", "bytes", "seconds", "speedup");
+	printf("%-12s %10lld %12s %10.3f %8.2f\n", "decode", (long long)frames, "-", decodeSeconds, 1.0);
+
+	// export seeks by itself, every run starts at same keyframe
+	uint64_t byteCount = 0;
+	MediaDecoderClipInfo clip = {0};
+	clip.startTime = startTime;
+	clip.endTime = endTime;
+	clip.callback = Bench_CountPacket;
+	clip.userData = &byteCount;
+	start = av_gettime_relative();
+	int64_t packets = MediaDecoder_ExportClip(context, &clip);
+	double seconds = Bench_Seconds(start);
+	if (packets < 0)
+	{
+		fprintf(stderr, "export to callback failed\n");
+	}
+	else
+	{
+		printf(
+			"%-12s %10lld %12llu %10.3f %8.2f\n", "passthrough", (long long)packets, (unsigned long long)byteCount,
+			seconds, decodeSeconds / seconds
+		);
+	}
+
+	if (outUrl)
+	{
+		clip.callback = NULL;
+		clip.userData = NULL;
+		clip.url = outUrl;
+		start = av_gettime_relative();
+		packets = MediaDecoder_ExportClip(context, &clip);
+		seconds = Bench_Seconds(start);
+		if (packets < 0)
+		{
+			fprintf(stderr, "export to %s failed\n", outUrl);
+		}
+		else
+		{
+			printf(
+				"%-12s %10lld %12s %10.3f %8.2f\n", "file", (long long)packets, "-", seconds, decodeSeconds / seconds
+			);
+		}
+	}
+
+	MediaDecoder_Close(&context);
+	return 0;
+}
+
+/// @brief Write frameCount numbered PNG images, each filled with a different gradient
+static int Bench_WriteSequence(const char* pattern, int frameCount)
+{
+	const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_PNG);
+	AVCodecContext* encoder = codec ? avcodec_alloc_context3(codec) : NULL;
+	AVFrame* frame = av_frame_alloc();
+	AVPacket* packet = av_packet_alloc();
+	int ret = encoder && frame && packet ? 0 : -1;
+	if (ret == 0)
+	{
+		encoder->width = frame->width = BENCH_SEQUENCE_WIDTH;
+		encoder->height = frame->height = BENCH_SEQUENCE_HEIGHT;
+		encoder->pix_fmt = AV_PIX_FMT_RGB24;
+		frame->format = AV_PIX_FMT_RGB24;
+		encoder->time_base = (AVRational){1, 25};
+		ret = avcodec_open2(encoder, codec, NULL) < 0 || av_frame_get_buffer(frame, 0) < 0 ? -1 : 0;
+	}
+
+	char path[1024];
+	for (int i = 0; ret == 0 && i < frameCount; i++)
+	{
+		for (int y = 0; y < BENCH_SEQUENCE_HEIGHT; y++)
+		{
+			uint8_t* row = frame->data[0] + y * frame->linesize[0];
+			for (int x = 0; x < BENCH_SEQUENCE_WIDTH; x++)
+			{
+				row[x * 3 + 0] = (uint8_t)(x + i * 8);
+				row[x * 3 + 1] = (uint8_t)y;
+				row[x * 3 + 2] = (uint8_t)(i * 8);
+			}
+		}
+
+		frame->pts = i;
+		if (avcodec_send_frame(encoder, frame) < 0 || avcodec_receive_packet(encoder, packet) < 0)
+		{
+			ret = -1;
+			break;
+		}
+
+		// numbering starts at 1 like exported sequences usually do
+		snprintf(path, sizeof(path), pattern, i + 1);
+		FILE* file = fopen(path, "wb");
+		if (!file || fwrite(packet->data, 1, packet->size, file) != (size_t)packet->size)
+			ret = -1;
+		if (file)
+			fclose(file);
+		av_packet_unref(packet);
+	}
+
+	av_packet_free(&packet);
+	av_frame_free(&frame);
+	avcodec_free_context(&encoder);
+	return ret;
+}
+
+static int Bench_Tensor(int argc, char** argv)
+{
+	if (argc < 1)
+		return 1;
+	char pattern[1024];
+	snprintf(pattern, sizeof(pattern), "%s/frame%%04d.png", argv[0]);
+	int frameCount = argc > 1 ? atoi(argv[1]) : BENCH_SEQUENCE_FRAMES;
+	if (frameCount < 2 || Bench_WriteSequence(pattern, frameCount))
+	{
+		fprintf(stderr, "could not write %d images to %s\n", frameCount, pattern);
+		return 1;
+	}
+
+	MediaDecoderContext* context = MediaDecoder_Open(pattern);
+	if (!context)
+	{
+		fprintf(stderr, "could not open %s\n", pattern);
+		return 1;
+	}
+
+	// first frame is shown normally, so that workers already convert following frames when tensor is decoded
+	uint32_t streamIndex = 0;
+	if (MediaDecoder_NextFrame(context, &streamIndex) || MediaDecoder_DecodeFrame(context))
+	{
+		fprintf(stderr, "could not decode first frame\n");
+		MediaDecoder_Close(&context);
+		return 1;
+	}
+
+	MediaDecoderTensorInfo tensor = {0};
+	tensor.frameCount = (uint32_t)frameCount - 1;
+	tensor.width = BENCH_TENSOR_SIZE;
+	tensor.height = BENCH_TENSOR_SIZE;
+	tensor.layout = TENSOR_LAYOUT_NCHW;
+	tensor.type = TENSOR_TYPE_FLOAT32;
+	tensor.data = malloc(sizeof(float) * 3 * BENCH_TENSOR_SIZE * BENCH_TENSOR_SIZE * tensor.frameCount);
+	if (!tensor.data)
+	{
+		MediaDecoder_Close(&context);
+		return 1;
+	}
+
+	int64_t start = av_gettime_relative();
+	int frames = MediaDecoder_DecodeTensor(context, &tensor);
+	double seconds = Bench_Seconds(start);
+	printf(
+		"tensor of %s: %d of %u frames, %.1f frames/s\n", pattern, frames, tensor.frameCount,
+		frames > 0 ? frames / seconds : 0.0
+	);
+
+	free(tensor.data);
+	MediaDecoder_Close(&context);
+	for (int i = 0; i < frameCount; i++)
+	{
+		char path[1024];
+		snprintf(path, sizeof(path), pattern, i + 1);
+		remove(path);
+	}
+	return frames == (int)tensor.frameCount ? 0 : 1;
+}
+
+#ifndef _WIN32
+typedef struct
+{
+	const char* path;
+	int frameCount;
+} BenchLiveSource;
+
+static void Bench_EncodeTime(uint8_t* luma, int64_t time)
+{
+	int blockWidth = BENCH_LIVE_WIDTH / 8;
+	int blockHeight = BENCH_LIVE_HEIGHT / 8;
+	for (int bit = 0; bit < 64; bit++)
+	{
+		uint8_t value = ((uint64_t)time >> bit) & 1 ? 255 : 0;
+		uint8_t* block = luma + (size_t)(bit / 8) * blockHeight * BENCH_LIVE_WIDTH + bit % 8 * blockWidth;
+		for (int y = 0; y < blockHeight; y++)
+			memset(block + (size_t)y * BENCH_LIVE_WIDTH, value, blockWidth);
+	}
+}
+
+static int64_t Bench_DecodeTime(const MediaDecoderPlaneInfo* luma)
+{
+	// center of each block is sampled, so that scaler does not blur neighbouring bits into it
+	uint32_t blockWidth = luma->width / 8;
+	uint32_t blockHeight = luma->height / 8;
+	uint64_t time = 0;
+	for (int bit = 0; bit < 64; bit++)
+	{
+		uint32_t x = bit % 8 * blockWidth + blockWidth / 2;
+		uint32_t y = bit / 8 * blockHeight + blockHeight / 2;
+		if (luma->data[(size_t)y * luma->stride + x] >= 128)
+			time |= (uint64_t)1 << bit;
+	}
+	return (int64_t)time;
+}
+
+/// @brief Write y4m frames into fifo at real time, each one showing time it was written
+static int Bench_LiveWrite(void* arg)
+{
+	const BenchLiveSource* source = arg;
+	FILE* file = fopen(source->path, "wb");
+	if (!file)
+		return 1;
+
+	// frames reach pipe in one write, as soon as they are written
+	setvbuf(file, NULL, _IONBF, 0);
+	fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", BENCH_LIVE_WIDTH, BENCH_LIVE_HEIGHT, BENCH_LIVE_FPS);
+
+	static const char header[] = "FRAME\n";
+	size_t headerSize = sizeof(header) - 1;
+	size_t lumaSize = (size_t)BENCH_LIVE_WIDTH * BENCH_LIVE_HEIGHT;
+	size_t frameSize = headerSize + lumaSize * 3 / 2;
+	uint8_t* frame = malloc(frameSize);
+	if (!frame)
+	{
+		fclose(file);
+		return 1;
+	}
+	memcpy(frame, header, headerSize);
+	memset(frame + headerSize + lumaSize, 128, lumaSize / 2);
+
+	int64_t start = av_gettime_relative();
+	for (int i = 0; i < source->frameCount; i++)
+	{
+		int64_t due = start + (int64_t)i * 1000000 / BENCH_LIVE_FPS;
+		int64_t now = av_gettime_relative();
+		if (due > now)
+			av_usleep((unsigned)(due - now));
+
+		Bench_EncodeTime(frame + headerSize, av_gettime_relative());
+		if (fwrite(frame, 1, frameSize, file) != frameSize)
+			break;
+	}
+
+	free(frame);
+	fclose(file);
+	return 0;
+}
+#endif
+
+static int Bench_Live(int argc, char** argv)
+{
+#ifdef _WIN32
+	(void)argc;
+	(void)argv;
+	fprintf(stderr, "live bench needs a fifo\n");
+	return 1;
+#else
+	if (argc < 1)
+		return 1;
+	BenchLiveSource source = {argv[0], (argc > 1 ? atoi(argv[1]) : 10) * BENCH_LIVE_FPS};
+
+	// writer must not be killed if reading stops early
+	signal(SIGPIPE, SIG_IGN);
+	if (mkfifo(source.path, 0600))
+	{
+		fprintf(stderr, "could not create fifo %s\n", source.path);
+		return 1;
+	}
+
+	// writer and reader both block in open until other side opened fifo as well
+	thrd_t writer;
+	if (thrd_create(&writer, Bench_LiveWrite, &source) != thrd_success)
+	{
+		remove(source.path);
+		return 1;
+	}
+
+	MediaDecoderContext* context = MediaDecoder_OpenLive(source.path);
+	if (!context)
+	{
+		fprintf(stderr, "could not open %s\n", source.path);
+		// writer is released by opening fifo once
+		FILE* file = fopen(source.path, "rb");
+		if (file)
+			fclose(file);
+		thrd_join(writer, NULL);
+		remove(source.path);
+		return 1;
+	}
+	context->video.decodedWidth = BENCH_LIVE_WIDTH;
+	context->video.decodedHeight = BENCH_LIVE_HEIGHT;
+	context->video.decodedPixelFormat = PIXEL_FORMAT_I420;
+
+	// latency is time from writing frame into fifo until it is converted into frame buffer
+	int64_t firstLatency = -1;
+	int64_t minLatency = INT64_MAX;
+	int64_t maxLatency = 0;
+	int64_t totalLatency = 0;
+	int frameCount = 0;
+	uint32_t streamIndex = 0;
+	while (MediaDecoder_NextFrame(context, &streamIndex) == 0)
+	{
+		if (streamIndex != context->playback.selectedVideoStream || MediaDecoder_DecodeFrame(context))
+			continue;
+
+		int64_t latency = av_gettime_relative() - Bench_DecodeTime(&context->video.planes[0]);
+		frameCount++;
+
+		// first frame also waits for probing, it is reported on its own
+		if (firstLatency < 0)
+		{
+			firstLatency = latency;
+			continue;
+		}
+		minLatency = FFMIN(minLatency, latency);
+		maxLatency = FFMAX(maxLatency, latency);
+		totalLatency += latency;
+	}
+
+	printf("live %dx%d y4m at %d fps through fifo\n", BENCH_LIVE_WIDTH, BENCH_LIVE_HEIGHT, BENCH_LIVE_FPS);
+	printf("frames %d of %d, dropped %u\n", frameCount, source.frameCount, context->playback.droppedFrames);
+	if (frameCount > 1)
+	{
+		printf(
+			"glass to buffer ms: first %.2f, min %.2f, avg %.2f, max %.2f\n", firstLatency / 1000.0,
+			minLatency / 1000.0, totalLatency / 1000.0 / (frameCount - 1), maxLatency / 1000.0
+		);
+	}
+
+	MediaDecoder_Close(&context);
+	thrd_join(writer, NULL);
+	remove(source.path);
+	return 0;
+#endif
+}
+
+static const BenchCommand commands[] = {
+	{"resample", "[outSampleRate]", Bench_Resample},
+	{"convert", "[channelCount]", Bench_Convert},
+	{"resize", "[width height]", Bench_Resize},
+	{"parallel", "url [width height]", Bench_Parallel},
+	{"preview", "url width height", Bench_Preview},
+	{"clip", "url startTime endTime [outUrl]", Bench_Clip},
+	{"tensor", "directory [frameCount]", Bench_Tensor},
+	{"live", "fifoPath [seconds]", Bench_Live},
+};
+
+int main(int argc, char** argv)
+{
+	for (size_t i = 0; argc > 1 && i < sizeof(commands) / sizeof(commands[0]); i++)
+	{
+		if (strcmp(argv[1], commands[i].name) == 0)
+			return commands[i].func(argc - 2, argv + 2);
+	}
+
+	fprintf(stderr, "usage:\n");
+	for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+		fprintf(stderr, "  %s %s %s\n", argv[0], commands[i].name, commands[i].usage);
+	return 1;
+}
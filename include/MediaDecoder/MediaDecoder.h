@@ -1,4 +1,5 @@
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct MediaDecoderPlaybackInfo
@@ -17,6 +18,16 @@ typedef struct MediaDecoderPlaybackInfo
 
 	double duration;
 	double position;
+
+	// when set, media continues at its start instead of ending. start of media is opened and decoded in background
+	// shortly before end, so that looping costs no more than reading a normal frame
+	int seamlessLoop;
+	// seconds MediaDecoder_NextFrame spent on continuing at start of media, at last loop
+	double loopLatency;
+	// number of times playback continued with media queued by MediaDecoder_QueueNext
+	uint32_t itemIndex;
+	// video frames of live input that were replaced by a newer frame before they were returned
+	uint32_t droppedFrames;
 } MediaDecoderPlaybackInfo;
 
 typedef enum MediaDecoderPixelFormat
@@ -29,6 +40,12 @@ typedef enum MediaDecoderPixelFormat
 	PIXEL_FORMAT_R16G16B16A16_UINT,
 	PIXEL_FORMAT_R16G16B16A16_FLOAT,
 	PIXEL_FORMAT_R32G32B32A32_FLOAT,
+
+	// planar formats, see MediaDecoderVideoInfo.planes for layout of each plane
+	PIXEL_FORMAT_NV12,
+	PIXEL_FORMAT_I420,
+	PIXEL_FORMAT_YUV444P,
+	PIXEL_FORMAT_P010,
 } MediaDecoderPixelFormat;
 
 typedef enum MediaDecoderSampleFormat
@@ -49,6 +66,52 @@ typedef enum MediaDecoderChannelLayout
 	//Surround71,
 } MediaDecoderChannelLayout;
 
+typedef struct MediaDecoderPlaneInfo
+{
+	uint8_t* data;
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;
+} MediaDecoderPlaneInfo;
+
+typedef enum MediaDecoderScaleQuality
+{
+	// bilinear, or area when image is shrunk to less than half of its size
+	SCALE_QUALITY_AUTO,
+	SCALE_QUALITY_FAST_BILINEAR,
+	SCALE_QUALITY_POINT,
+	SCALE_QUALITY_BILINEAR,
+	SCALE_QUALITY_BICUBIC,
+	SCALE_QUALITY_AREA,
+	SCALE_QUALITY_LANCZOS,
+} MediaDecoderScaleQuality;
+
+typedef enum MediaDecoderMipFilter
+{
+	MIP_FILTER_BOX,
+	MIP_FILTER_BILINEAR,
+} MediaDecoderMipFilter;
+
+typedef enum MediaDecoderResampleQuality
+{
+	// swresample defaults
+	RESAMPLE_QUALITY_DEFAULT,
+	// cheapest filter for previews and scrubbing
+	RESAMPLE_QUALITY_PREVIEW,
+	// short filter with low delay for interactive playback
+	RESAMPLE_QUALITY_REALTIME,
+	// soxr when available, otherwise long swresample filter
+	RESAMPLE_QUALITY_MASTERING,
+} MediaDecoderResampleQuality;
+
+typedef enum MediaDecoderPreviewMode
+{
+	// use faster but less accurate decoding when frames are decoded at half size or less
+	PREVIEW_MODE_AUTO,
+	// always decode frames at full quality
+	PREVIEW_MODE_OFF,
+} MediaDecoderPreviewMode;
+
 typedef struct MediaDecoderVideoInfo
 {
 	uint32_t originalWidth;
@@ -56,10 +119,25 @@ typedef struct MediaDecoderVideoInfo
 	uint32_t decodedWidth;
 	uint32_t decodedHeight;
 	MediaDecoderPixelFormat decodedPixelFormat;
+	// filter used when frame is scaled, can be changed between frames
+	MediaDecoderScaleQuality scaleQuality;
+	// decoding shortcuts used for small outputs, changes take effect at next keyframe
+	MediaDecoderPreviewMode previewMode;
 
 	uint8_t* frameBuffer;
 
 	uint32_t bytesPerFrame;
+
+	// layout of frameBuffer, packed formats only use first plane
+	uint32_t planeCount;
+	MediaDecoderPlaneInfo planes[4];
+
+	// optional caller owned mip chain which is filled while frameBuffer is being converted.
+	// each level must be half the size of previous level (rounded down, but at least 1),
+	// first level is half the size of decoded frame. only 8bit packed formats are supported.
+	MediaDecoderPlaneInfo* mipLevels;
+	uint32_t mipLevelCount;
+	MediaDecoderMipFilter mipFilter;
 } MediaDecoderVideoInfo;
 
 typedef struct MediaDecoderAudioInfo
@@ -76,6 +154,14 @@ typedef struct MediaDecoderAudioInfo
 	uint32_t sampleCapacityPerChannel;
 	uint32_t sampleCountPerChannel;
 	uint32_t channelCount;
+
+	// when not 0, frames contain exactly this many samples per channel. last frame is padded with silence and
+	// sampleCountPerChannel tells how many samples it really contains.
+	uint32_t blockSizePerChannel;
+	// seconds of audio that were already decoded, but are still held by resampler or current block
+	double delay;
+	// filter used when sample rate is converted, can be changed between frames
+	MediaDecoderResampleQuality resampleQuality;
 } MediaDecoderAudioInfo;
 
 typedef enum MediaDecoderStreamType
@@ -83,6 +169,7 @@ typedef enum MediaDecoderStreamType
 	UNKNOWN_STREAM,
 	VIDEO_STREAM,
 	AUDIO_STREAM,
+	SUBTITLE_STREAM,
 } MediaDecoderStreamType;
 
 typedef struct MediaDecoderStreamInfo
@@ -94,6 +181,125 @@ typedef struct MediaDecoderStreamInfo
 	double duration;
 } MediaDecoderStreamInfo;
 
+typedef struct MediaDecoderImageCacheStats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	// includes images that are in use, which do not count against budget
+	uint64_t bytesResident;
+	uint64_t budget;
+	uint32_t entryCount;
+} MediaDecoderImageCacheStats;
+
+typedef struct MediaDecoderContactSheetInfo
+{
+	uint32_t columns;
+	uint32_t rows;
+	uint32_t tileWidth;
+	uint32_t tileHeight;
+	MediaDecoderPixelFormat pixelFormat;
+
+	// caller owned buffer of columns * tileWidth by rows * tileHeight pixels
+	uint8_t* frameBuffer;
+	// bytes between rows of frameBuffer, 0 if rows are tightly packed
+	uint32_t stride;
+} MediaDecoderContactSheetInfo;
+
+/// @brief Receives decoded frames of offline decoding functions, in presentation order
+/// @param video converted frame, frameBuffer is only valid during the call
+/// @param time presentation time of frame in seconds
+/// @return 0 to continue decoding, anything else stops it
+typedef int (*MediaDecoderFrameCallback)(void* userData, const MediaDecoderVideoInfo* video, double time);
+
+typedef struct MediaDecoderParallelInfo
+{
+	// number of decoders running at once, 0 uses one per cpu core
+	uint32_t threadCount;
+	// output size, 0 keeps original size
+	uint32_t decodedWidth;
+	uint32_t decodedHeight;
+	MediaDecoderPixelFormat decodedPixelFormat;
+	MediaDecoderScaleQuality scaleQuality;
+	// maximum bytes of converted frames waiting to be delivered, 0 uses 512 MiB
+	uint64_t memoryBudget;
+
+	MediaDecoderFrameCallback callback;
+	void* userData;
+} MediaDecoderParallelInfo;
+
+typedef struct MediaDecoderScanKeyframe
+{
+	// presentation time in seconds
+	double time;
+	// byte offset of packet in file, -1 if unknown
+	int64_t position;
+	// packets from this keyframe up to next one
+	uint32_t gopLength;
+} MediaDecoderScanKeyframe;
+
+typedef struct MediaDecoderScanStream
+{
+	MediaDecoderStreamType type;
+	// every packet holds one frame of video
+	uint64_t packetCount;
+	uint64_t byteCount;
+	// presentation time of earliest packet and end of latest packet in seconds
+	double startTime;
+	double endTime;
+
+	// keyframes in file order, only filled for video streams
+	MediaDecoderScanKeyframe* keyframes;
+	uint32_t keyframeCount;
+	uint32_t maxGopLength;
+
+	// bytes of packets decoded within each interval of MediaDecoderScanInfo.interval seconds since start of media
+	uint64_t* bytesPerInterval;
+	uint32_t intervalCount;
+	// number of packets with at least 2^i and less than 2^(i+1) bytes, empty packets are counted in first entry
+	uint32_t sizeHistogram[32];
+} MediaDecoderScanStream;
+
+typedef struct MediaDecoderScanInfo
+{
+	// seconds from earliest to end of latest packet of all streams
+	double duration;
+	// seconds covered by each entry of bytesPerInterval
+	double interval;
+	uint32_t streamCount;
+	MediaDecoderScanStream* streams;
+} MediaDecoderScanInfo;
+
+typedef struct MediaDecoderPacket
+{
+	uint32_t streamIndex;
+	// compressed data, only valid during callback
+	const uint8_t* data;
+	uint32_t size;
+	// seconds since start of clip, dts may be negative for streams with reordered frames
+	double pts;
+	double dts;
+	double duration;
+	int isKeyframe;
+} MediaDecoderPacket;
+
+/// @brief Receives compressed packets of MediaDecoder_ExportClip, in file order
+/// @return 0 to continue, anything else stops export
+typedef int (*MediaDecoderPacketCallback)(void* userData, const MediaDecoderPacket* packet);
+
+typedef struct MediaDecoderClipInfo
+{
+	// clip starts at keyframe at or before startTime, and ends with last packet decoded before endTime. with
+	// reordered frames, a few frames shown after endTime are included. endTime of 0 exports up to end
+	double startTime;
+	double endTime;
+
+	// file to write, container is chosen by its extension. only used if callback is not set
+	const char* url;
+	MediaDecoderPacketCallback callback;
+	void* userData;
+} MediaDecoderClipInfo;
+
 typedef struct MediaDecoderContext
 {
 	MediaDecoderPlaybackInfo playback;
@@ -101,6 +307,102 @@ typedef struct MediaDecoderContext
 	MediaDecoderAudioInfo audio;
 } MediaDecoderContext;
 
+typedef enum MediaDecoderTensorLayout
+{
+	// all red samples of frame, then all green and all blue samples
+	TENSOR_LAYOUT_NCHW,
+	// red, green and blue sample of each pixel next to each other
+	TENSOR_LAYOUT_NHWC,
+} MediaDecoderTensorLayout;
+
+typedef enum MediaDecoderTensorType
+{
+	TENSOR_TYPE_UINT8,
+	// samples are normalized with mean and std
+	TENSOR_TYPE_FLOAT32,
+} MediaDecoderTensorType;
+
+typedef struct MediaDecoderTensorInfo
+{
+	// caller owned memory for frameCount * 3 * height * width samples
+	void* data;
+	uint32_t frameCount;
+	uint32_t width;
+	uint32_t height;
+	MediaDecoderTensorLayout layout;
+	MediaDecoderTensorType type;
+	MediaDecoderScaleQuality scaleQuality;
+
+	// float samples are (value / 255 - mean) / std per red, green and blue channel, std of 0 is treated as 1
+	float mean[3];
+	float std[3];
+
+	// frames are sampled at fps if it is greater than 0, otherwise every frameStep'th frame is used
+	double fps;
+	uint32_t frameStep;
+} MediaDecoderTensorInfo;
+
+typedef enum MediaDecoderFrameCacheMode
+{
+	FRAME_CACHE_OFF,
+	// frames are converted while they are decoded, showing cached frame is a copy
+	FRAME_CACHE_CONVERTED,
+	// frames are kept in compact format of decoder, showing cached frame converts it
+	FRAME_CACHE_DECODED,
+} MediaDecoderFrameCacheMode;
+
+/// @brief Handle of file that is being opened in background, see MediaDecoder_OpenAsync
+typedef struct MediaDecoderOpenRequest MediaDecoderOpenRequest;
+
+/// @brief Called on worker thread when background open finished, or on thread of MediaDecoder_WaitOpen if it
+/// opened file itself because no worker had started yet
+/// @param result 0 if file was opened, -1 if it failed. not called for cancelled requests
+typedef void (*MediaDecoderOpenCallback)(void* userData, int result);
+
+/// @brief Memory functions used for everything that library allocates itself, including decoded video frames
+typedef struct MediaDecoderAllocator
+{
+	// should return memory aligned to alignment, but library also aligns blocks itself when allocator ignores it
+	void* (*alloc)(void* userData, size_t size, size_t alignment);
+	void (*free)(void* userData, void* ptr);
+	void* userData;
+} MediaDecoderAllocator;
+
+typedef enum MediaDecoderBudgetPolicy
+{
+	// MediaDecoder_Open fails while memory budget is exceeded
+	BUDGET_POLICY_REFUSE,
+	// MediaDecoder_Open succeeds, but video of new context is decoded at half size
+	BUDGET_POLICY_DEGRADE,
+} MediaDecoderBudgetPolicy;
+
+/// @brief Lowers video quality of contexts it is attached to while they can not keep up, see MediaDecoder_SetGovernor
+typedef struct MediaDecoderGovernor MediaDecoderGovernor;
+
+// each level also uses shortcuts of levels before it
+typedef enum MediaDecoderGovernorLevel
+{
+	GOVERNOR_LEVEL_FULL,
+	// fast bilinear scaling instead of video.scaleQuality
+	GOVERNOR_LEVEL_FAST_SCALING,
+	// frames are converted at half of requested size, video.planes tell size of converted image
+	GOVERNOR_LEVEL_HALF_SIZE,
+	// frames no other frame depends on are not decoded, which lowers frame rate of most videos
+	GOVERNOR_LEVEL_SKIP_NONREF,
+	// every other decoded video frame is dropped without being returned
+	GOVERNOR_LEVEL_HALF_RATE,
+} MediaDecoderGovernorLevel;
+
+typedef struct MediaDecoderGovernorInfo
+{
+	MediaDecoderGovernorLevel level;
+	// smoothed seconds spent on decoding and converting a video frame, divided by seconds it is shown
+	double load;
+	// number of times level was lowered or raised
+	uint32_t stepDownCount;
+	uint32_t stepUpCount;
+} MediaDecoderGovernorInfo;
+
 #define MEDIADECODER_EXPORT //__declspec(dllexport)
 
 #ifdef __cplusplus
@@ -108,6 +410,31 @@ extern "C"
 {
 #endif
 	MEDIADECODER_EXPORT MediaDecoderContext* MediaDecoder_Open(const char* url);
+
+	/// @brief Open live input like a pipe or UDP stream with as little latency as possible
+	///
+	/// Input is probed only briefly and neither demuxer nor decoder hold frames back. MediaDecoder_NextFrame reads
+	/// everything that already arrived and returns newest video frame, older ones are dropped. Audio frames are
+	/// never dropped.
+	MEDIADECODER_EXPORT MediaDecoderContext* MediaDecoder_OpenLive(const char* url);
+
+	/// @brief Open file on background thread, many files can be opened at once
+	/// @param callback optional, called when open finished
+	/// @return request that must be finished with MediaDecoder_WaitOpen or MediaDecoder_CancelOpen
+	MEDIADECODER_EXPORT MediaDecoderOpenRequest* MediaDecoder_OpenAsync(
+		const char* url, MediaDecoderOpenCallback callback, void* userData
+	);
+
+	/// @return 1 if open finished and MediaDecoder_WaitOpen returns without blocking, otherwise 0
+	MEDIADECODER_EXPORT int MediaDecoder_PollOpen(MediaDecoderOpenRequest* request);
+
+	/// @brief Wait until open finished and release request. if no worker started on request yet, file is opened
+	/// on calling thread
+	/// @return opened context or NULL if open failed
+	MEDIADECODER_EXPORT MediaDecoderContext* MediaDecoder_WaitOpen(MediaDecoderOpenRequest** request);
+
+	/// @brief Abort open and release request without waiting, context is closed once it was opened
+	MEDIADECODER_EXPORT void MediaDecoder_CancelOpen(MediaDecoderOpenRequest** request);
 	//MEDIADECODER_EXPORT MediaDecoderStreamInfo MediaDecoder_GetStreamInfo(MediaDecoderContext* context, uint32_t streamIndex);
 	//MEDIADECODER_EXPORT int MediaDecoder_SelectVideoStream(MediaDecoderContext* context, uint32_t steramIndex);
 	//MEDIADECODER_EXPORT int MediaDecoder_SelectAudioStream(MediaDecoderContext* context, uint32_t steramIndex);
@@ -126,6 +453,127 @@ extern "C"
 	MEDIADECODER_EXPORT int MediaDecoder_DecodeFrame(MediaDecoderContext* context);
 	MEDIADECODER_EXPORT int MediaDecoder_Seek(MediaDecoderContext* context, double time);
 	MEDIADECODER_EXPORT int MediaDecoder_Close(MediaDecoderContext** context);
+
+	/// @brief Read following video frames and convert sampled ones directly into tensor, other frames are only
+	/// decoded
+	/// @return number of frames written, less than frameCount if end of stream was reached. -1 on error
+	MEDIADECODER_EXPORT int MediaDecoder_DecodeTensor(
+		MediaDecoderContext* context, const MediaDecoderTensorInfo* tensor
+	);
+
+	/// @brief Keep frames decoded by MediaDecoder_SeekFrame and MediaDecoder_StepFrame, so that scrubbing and
+	/// stepping backwards does not decode same frames again
+	/// @param bytes maximum memory used by cached frames, frames farthest from current frame are dropped first
+	/// @return 0 on success
+	MEDIADECODER_EXPORT int MediaDecoder_SetFrameCache(
+		MediaDecoderContext* context, MediaDecoderFrameCacheMode mode, uint64_t bytes
+	);
+
+	/// @brief Read video frame that is shown at time, frames from previous keyframe on are decoded if needed
+	/// @return 0 on success, frame is converted by MediaDecoder_DecodeFrame
+	MEDIADECODER_EXPORT int MediaDecoder_SeekFrame(MediaDecoderContext* context, double time);
+
+	/// @brief Read video frame count frames after (or before, if count is negative) current frame
+	/// @return 0 on success, 1 if start or end of stream was reached, frame is converted by MediaDecoder_DecodeFrame
+	MEDIADECODER_EXPORT int MediaDecoder_StepFrame(MediaDecoderContext* context, int count);
+
+	/// @brief Open media in background and read its first frame, playback continues with it once current media ended
+	/// @param url media to continue with, replaces media that was queued before. NULL only removes queued media
+	/// @return 0 on success
+	///
+	/// Stream indices, duration and original size or sample rate change when playback continues with next media.
+	/// Output settings, buffers and audio blocks stay, so that no samples are lost or repeated at transition.
+	MEDIADECODER_EXPORT int MediaDecoder_QueueNext(MediaDecoderContext* context, const char* url);
+
+	/// @brief Fill tiles of contact sheet with evenly spaced video frames, left to right and top to bottom
+	/// @param url media to read frames from
+	/// @param sheet layout of tiles, only packed pixel formats are supported
+	/// @return number of distinct frames drawn, -1 if no frame could be decoded. remaining tiles repeat last frame
+	MEDIADECODER_EXPORT int MediaDecoder_CreateContactSheet(const char* url, const MediaDecoderContactSheetInfo* sheet);
+
+	/// @brief Decode whole video stream by splitting it at keyframes and decoding each part on its own decoder
+	/// @param url media to decode, it is opened once for every thread
+	/// @param info output format and callback that receives frames in presentation order
+	/// @return number of delivered frames, -1 on error
+	MEDIADECODER_EXPORT int64_t MediaDecoder_DecodeParallel(const char* url, const MediaDecoderParallelInfo* info);
+
+	/// @brief Read all packets of media without decoding them, to get exact counts, duration and keyframes
+	/// @param interval seconds per entry of bitrate graph, 0 uses 1 second
+	/// @return summary indexed like streams of media, NULL on error. release it with MediaDecoder_ReleaseScan
+	MEDIADECODER_EXPORT MediaDecoderScanInfo* MediaDecoder_Scan(const char* url, double interval);
+	MEDIADECODER_EXPORT void MediaDecoder_ReleaseScan(MediaDecoderScanInfo** scan);
+
+	/// @brief Set size of process wide cache of converted still images, cache is disabled by default
+	/// @param bytes maximum amount of memory used by images that are not in use, 0 disables cache
+	///
+	/// Contexts that open a cached image share the same frameBuffer, which must be treated as read only.
+	MEDIADECODER_EXPORT void MediaDecoder_SetImageCacheBudget(uint64_t bytes);
+	MEDIADECODER_EXPORT MediaDecoderImageCacheStats MediaDecoder_GetImageCacheStats();
+
+	/// @brief Replace memory functions of library, NULL restores malloc and free
+	/// @return 0 on success, -1 if memory allocated by previous allocator is still in use
+	MEDIADECODER_EXPORT int MediaDecoder_SetAllocator(const MediaDecoderAllocator* allocator);
+
+	/// @brief Limit memory that library allocates itself, 0 (default) means no limit
+	/// @param policy what MediaDecoder_Open does while limit is exceeded
+	///
+	/// Memory that FFmpeg allocates internally, apart from decoded video frames, is not counted.
+	MEDIADECODER_EXPORT void MediaDecoder_SetMemoryBudget(uint64_t bytes, MediaDecoderBudgetPolicy policy);
+	MEDIADECODER_EXPORT uint64_t MediaDecoder_GetMemoryUsage();
+
+	/// @brief Create governor that measures decoding cost of contexts attached to it
+	/// @param targetLoad load above which quality is lowered, 0 uses 0.8. quality is raised again once load stays
+	/// well below target for a few seconds
+	MEDIADECODER_EXPORT MediaDecoderGovernor* MediaDecoder_CreateGovernor(double targetLoad);
+
+	/// @brief Release governor, contexts that are still attached keep using it until they are closed
+	MEDIADECODER_EXPORT void MediaDecoder_ReleaseGovernor(MediaDecoderGovernor** governor);
+	MEDIADECODER_EXPORT MediaDecoderGovernorInfo MediaDecoder_GetGovernorInfo(MediaDecoderGovernor* governor);
+
+	/// @brief Attach context to governor, contexts sharing a governor form a pool that changes level together
+	/// @param governor governor to attach to, NULL detaches context and restores full quality
+	/// @return 0 on success
+	MEDIADECODER_EXPORT int MediaDecoder_SetGovernor(MediaDecoderContext* context, MediaDecoderGovernor* governor);
+
+	/// @brief Add another output of video frames converted by MediaDecoder_DecodeFrame, without decoding them again
+	/// @return view that is updated along with context->video, NULL on error. views of same size and format share
+	/// one rendition, so each frame is only converted once for them
+	///
+	/// Smaller views are scaled down from a larger output of same format when that is cheaper than converting whole
+	/// frame. Frames shown from cache of converted frames (see MediaDecoder_SetFrameCache) do not update views.
+	MEDIADECODER_EXPORT const MediaDecoderVideoInfo* MediaDecoder_AddView(
+		MediaDecoderContext* context, uint32_t width, uint32_t height, MediaDecoderPixelFormat pixelFormat
+	);
+
+	/// @brief Remove view returned by MediaDecoder_AddView, its frameBuffer is freed once no other view uses it
+	/// @return 0 on success
+	MEDIADECODER_EXPORT int MediaDecoder_RemoveView(MediaDecoderContext* context, const MediaDecoderVideoInfo* view);
+
+	/// @brief Take ownership of video.frameBuffer, next converted frame is written into a new buffer
+	/// @return buffer that must be freed with MediaDecoder_FreeBuffer, NULL on error. planes start at same offsets in
+	/// it as in frameBuffer
+	MEDIADECODER_EXPORT uint8_t* MediaDecoder_TakeFrameBuffer(MediaDecoderContext* context);
+	MEDIADECODER_EXPORT void MediaDecoder_FreeBuffer(uint8_t* buffer);
+
+	/// @brief Run func on worker threads of library, which also open media in background
+	/// @return 0 on success
+	MEDIADECODER_EXPORT int MediaDecoder_RunTask(void (*func)(void* arg), void* arg);
+
+	/// @brief Release demuxer, decoders, converters and buffers of context that is not played, until
+	/// MediaDecoder_Resume is called. reading, decoding and seeking fail meanwhile. not supported for live input.
+	/// media queued with MediaDecoder_QueueNext is opened again on resume
+	/// @param keepWidth if keepWidth and keepHeight are not 0, shown frame stays in video.frameBuffer at this size
+	/// @return 0 on success
+	MEDIADECODER_EXPORT int MediaDecoder_Suspend(MediaDecoderContext* context, uint32_t keepWidth, uint32_t keepHeight);
+
+	/// @brief Open media of suspended context again and decode exactly frame that was shown when it was suspended
+	/// @return 0 on success, frame is already converted into video.frameBuffer and views
+	MEDIADECODER_EXPORT int MediaDecoder_Resume(MediaDecoderContext* context);
+
+	/// @brief Copy compressed packets of selected streams in time range to a new file or callback, without decoding
+	/// them. context must be seeked before reading further frames
+	/// @return number of exported packets, -1 on error
+	MEDIADECODER_EXPORT int64_t MediaDecoder_ExportClip(MediaDecoderContext* context, const MediaDecoderClipInfo* clip);
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,405 @@
+#pragma once
+
+#include "MediaDecoder.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace MediaDecoder
+{
+	/// @brief Runs function on some thread, decoding and resuming of coroutines happen there
+	using Executor = std::function<void(std::function<void()>)>;
+
+	/// @brief Executor that uses worker threads of library
+	inline Executor DefaultExecutor()
+	{
+		return [](std::function<void()> func)
+		{
+			auto* task = new std::function<void()>(std::move(func));
+			auto run = [](void* arg)
+			{
+				std::unique_ptr<std::function<void()>> task(static_cast<std::function<void()>*>(arg));
+				(*task)();
+			};
+			if (MediaDecoder_RunTask(run, task))
+				run(task);
+		};
+	}
+
+	class Error : public std::runtime_error
+	{
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	/// @brief Converted video frame that owns its buffer
+	class Frame
+	{
+	public:
+		Frame() = default;
+		Frame(const Frame&) = delete;
+		Frame& operator=(const Frame&) = delete;
+
+		Frame(Frame&& other) noexcept
+			: info(other.info), presentationTime(other.presentationTime)
+		{
+			other.info.frameBuffer = nullptr;
+		}
+
+		Frame& operator=(Frame&& other) noexcept
+		{
+			if (this != &other)
+			{
+				MediaDecoder_FreeBuffer(info.frameBuffer);
+				info = other.info;
+				presentationTime = other.presentationTime;
+				other.info.frameBuffer = nullptr;
+			}
+			return *this;
+		}
+
+		~Frame()
+		{
+			MediaDecoder_FreeBuffer(info.frameBuffer);
+		}
+
+		explicit operator bool() const
+		{
+			return info.frameBuffer != nullptr;
+		}
+
+		/// @brief Size of converted image, less than requested output size while governor halves it
+		uint32_t width() const
+		{
+			return info.planes[0].width;
+		}
+
+		uint32_t height() const
+		{
+			return info.planes[0].height;
+		}
+
+		MediaDecoderPixelFormat pixel_format() const
+		{
+			return info.decodedPixelFormat;
+		}
+
+		/// @brief Presentation time in seconds
+		double time() const
+		{
+			return presentationTime;
+		}
+
+		std::span<const uint8_t> data() const
+		{
+			return {info.frameBuffer, info.bytesPerFrame};
+		}
+
+		uint32_t plane_count() const
+		{
+			return info.planeCount;
+		}
+
+		/// @brief All rows of plane, each one stride(index) bytes apart
+		std::span<const uint8_t> plane(uint32_t index) const
+		{
+			const MediaDecoderPlaneInfo& plane = info.planes[index];
+			return {plane.data, static_cast<size_t>(plane.stride) * plane.height};
+		}
+
+		uint32_t stride(uint32_t index) const
+		{
+			return info.planes[index].stride;
+		}
+
+		const MediaDecoderVideoInfo& video_info() const
+		{
+			return info;
+		}
+
+	private:
+		friend struct DecoderState;
+
+		MediaDecoderVideoInfo info{};
+		double presentationTime = 0.0;
+	};
+
+	/// @brief Context and frame that is being decoded in background, shared by decoder and running decode task
+	struct DecoderState
+	{
+		MediaDecoderContext* context = nullptr;
+		Executor executor;
+		bool readAhead = true;
+
+		std::mutex lock;
+		std::condition_variable finished;
+		bool isBusy = false;
+		bool hasResult = false;
+		// 0 if frame was decoded, 1 at end of stream, -1 on error
+		int result = 0;
+		Frame frame;
+		std::coroutine_handle<> waiter;
+
+		DecoderState(MediaDecoderContext* context, Executor executor)
+			: context(context), executor(std::move(executor))
+		{
+		}
+
+		~DecoderState()
+		{
+			MediaDecoder_Close(&context);
+		}
+
+		/// @brief Decode next video frame on executor, unless it is already being decoded or was decoded
+		static void Start(const std::shared_ptr<DecoderState>& state)
+		{
+			{
+				std::lock_guard<std::mutex> guard(state->lock);
+				if (state->isBusy || state->hasResult)
+					return;
+				state->isBusy = true;
+			}
+			state->executor([state]() { Decode(state); });
+		}
+
+		static void Decode(const std::shared_ptr<DecoderState>& state)
+		{
+			MediaDecoderContext* context = state->context;
+			Frame frame;
+			int result;
+			for (;;)
+			{
+				// audio frames are skipped
+				uint32_t streamIndex = 0;
+				result = MediaDecoder_NextFrame(context, &streamIndex);
+				if (result != 0)
+					break;
+				if (streamIndex != context->playback.selectedVideoStream)
+					continue;
+
+				result = MediaDecoder_DecodeFrame(context) ? -1 : 0;
+				if (result == 0)
+					result = TakeFrame(context, frame);
+				break;
+			}
+
+			std::coroutine_handle<> waiter;
+			{
+				std::lock_guard<std::mutex> guard(state->lock);
+				state->frame = std::move(frame);
+				state->result = result;
+				state->hasResult = true;
+				state->isBusy = false;
+				waiter = std::exchange(state->waiter, nullptr);
+			}
+			state->finished.notify_all();
+			if (waiter)
+				waiter.resume();
+		}
+
+		static int TakeFrame(MediaDecoderContext* context, Frame& frame)
+		{
+			// buffer is taken instead of copied, decoder converts next frame into a new one
+			const MediaDecoderVideoInfo video = context->video;
+			frame.info = video;
+			frame.info.frameBuffer = MediaDecoder_TakeFrameBuffer(context);
+			if (!frame.info.frameBuffer)
+				return -1;
+
+			for (uint32_t i = 0; i < video.planeCount; i++)
+				frame.info.planes[i].data = frame.info.frameBuffer + (video.planes[i].data - video.frameBuffer);
+			frame.info.mipLevels = nullptr;
+			frame.info.mipLevelCount = 0;
+			frame.presentationTime = context->playback.position;
+			return 0;
+		}
+
+		/// @brief Take finished result, lock must be held
+		static std::optional<Frame> TakeResult(const std::shared_ptr<DecoderState>& state)
+		{
+			state->hasResult = false;
+			if (state->result < 0)
+				throw Error("MediaDecoder: decoding failed");
+			if (state->result > 0)
+				return std::nullopt;
+			return std::move(state->frame);
+		}
+	};
+
+	/// @brief Awaitable returned by Decoder::next_frame
+	class NextFrameAwaitable
+	{
+	public:
+		explicit NextFrameAwaitable(std::shared_ptr<DecoderState> state) : state(std::move(state))
+		{
+		}
+
+		bool await_ready() const
+		{
+			DecoderState::Start(state);
+			std::lock_guard<std::mutex> guard(state->lock);
+			return state->hasResult;
+		}
+
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			// frame may have been finished between await_ready and now
+			std::lock_guard<std::mutex> guard(state->lock);
+			if (state->hasResult)
+				return false;
+			state->waiter = handle;
+			return true;
+		}
+
+		std::optional<Frame> await_resume()
+		{
+			std::optional<Frame> frame;
+			bool readAhead;
+			{
+				std::lock_guard<std::mutex> guard(state->lock);
+				frame = DecoderState::TakeResult(state);
+				readAhead = state->readAhead;
+			}
+
+			// following frame is decoded while caller works on this one
+			if (frame && readAhead)
+				DecoderState::Start(state);
+			return frame;
+		}
+
+	private:
+		std::shared_ptr<DecoderState> state;
+	};
+
+	/// @brief Owning, move only handle of decoder context
+	///
+	/// Frames are decoded on executor and one frame ahead by default. Settings of context() may only be changed
+	/// before first frame is requested, or while read ahead is disabled and no frame is being decoded.
+	class Decoder
+	{
+	public:
+		/// @brief Take ownership of context returned by MediaDecoder_Open
+		explicit Decoder(MediaDecoderContext* context, Executor executor = DefaultExecutor())
+			: state(std::make_shared<DecoderState>(context, std::move(executor)))
+		{
+		}
+
+		Decoder(Decoder&&) noexcept = default;
+		Decoder& operator=(Decoder&&) noexcept = default;
+		Decoder(const Decoder&) = delete;
+		Decoder& operator=(const Decoder&) = delete;
+
+		/// @brief Context stays open until frame that is being decoded in background is finished
+		~Decoder() = default;
+
+		static Decoder open(const std::string& url, Executor executor = DefaultExecutor())
+		{
+			MediaDecoderContext* context = MediaDecoder_Open(url.c_str());
+			if (!context)
+				throw Error("MediaDecoder: could not open " + url);
+			return Decoder(context, std::move(executor));
+		}
+
+		/// @brief Awaitable that opens media on worker threads of library, use as co_await Decoder::open_async(url)
+		class OpenAwaitable
+		{
+		public:
+			OpenAwaitable(std::string url, Executor executor) : url(std::move(url)), executor(std::move(executor))
+			{
+			}
+
+			bool await_ready() const
+			{
+				return false;
+			}
+
+			bool await_suspend(std::coroutine_handle<> handle)
+			{
+				// callback may run before MediaDecoder_OpenAsync returned, whichever of both finishes last resumes
+				waiter = handle;
+				request = MediaDecoder_OpenAsync(url.c_str(), &OpenAwaitable::Finished, this);
+				if (!request)
+					return false;
+				return !hasArrived.exchange(true, std::memory_order_acq_rel);
+			}
+
+			Decoder await_resume()
+			{
+				MediaDecoderContext* context = MediaDecoder_WaitOpen(&request);
+				if (!context)
+					throw Error("MediaDecoder: could not open " + url);
+				return Decoder(context, std::move(executor));
+			}
+
+		private:
+			static void Finished(void* userData, int)
+			{
+				OpenAwaitable* awaitable = static_cast<OpenAwaitable*>(userData);
+				if (awaitable->hasArrived.exchange(true, std::memory_order_acq_rel))
+					awaitable->waiter.resume();
+			}
+
+			std::string url;
+			Executor executor;
+			MediaDecoderOpenRequest* request = nullptr;
+			std::coroutine_handle<> waiter;
+			std::atomic<bool> hasArrived = false;
+		};
+
+		static OpenAwaitable open_async(std::string url, Executor executor = DefaultExecutor())
+		{
+			return OpenAwaitable(std::move(url), std::move(executor));
+		}
+
+		MediaDecoderContext* context() const
+		{
+			return state->context;
+		}
+
+		/// @brief Decode following frames only when they are requested
+		void set_read_ahead(bool readAhead)
+		{
+			std::lock_guard<std::mutex> guard(state->lock);
+			state->readAhead = readAhead;
+		}
+
+		/// @brief Next video frame, use as co_await decoder.next_frame()
+		/// @return awaitable resulting in frame or std::nullopt at end of stream, throws Error if decoding failed
+		NextFrameAwaitable next_frame()
+		{
+			return NextFrameAwaitable(state);
+		}
+
+		/// @brief Blocking version of next_frame
+		std::optional<Frame> read_frame()
+		{
+			DecoderState::Start(state);
+			std::optional<Frame> frame;
+			bool readAhead;
+			{
+				std::unique_lock<std::mutex> guard(state->lock);
+				state->finished.wait(guard, [this]() { return state->hasResult; });
+				frame = DecoderState::TakeResult(state);
+				readAhead = state->readAhead;
+			}
+
+			if (frame && readAhead)
+				DecoderState::Start(state);
+			return frame;
+		}
+
+	private:
+		std::shared_ptr<DecoderState> state;
+	};
+} // namespace MediaDecoder
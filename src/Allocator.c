@@ -0,0 +1,309 @@
+#include "Allocator.h"
+
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#define MEMORY_ALIGNMENT 64
+// decoders may read and write a little past end of each plane
+#define FRAME_PADDING (16 + MEMORY_ALIGNMENT)
+// frame buffers that are not in use are kept until they take more than this
+#define FRAME_POOL_IDLE_LIMIT (64ull * 1024 * 1024)
+
+typedef struct
+{
+	// pointer returned by allocator
+	void* block;
+	size_t size;
+} AllocationHeader;
+
+typedef struct IdleBuffer
+{
+	struct IdleBuffer* next;
+} IdleBuffer;
+
+typedef struct
+{
+	MediaDecoderAllocator allocator;
+	atomic_uint_fast64_t usage;
+	uint64_t budget;
+	MediaDecoderBudgetPolicy policy;
+
+	// frame buffers that were returned by decoders and can be reused
+	mtx_t lock;
+	IdleBuffer* idleBuffers;
+	uint64_t idleBytes;
+} Allocator;
+
+static Allocator state;
+static once_flag stateInitFlag = ONCE_FLAG_INIT;
+
+static void* Allocator_DefaultAlloc(void* userData, size_t size, size_t alignment)
+{
+	// blocks are aligned by Allocator_Alloc itself
+	return malloc(size);
+}
+
+static void Allocator_DefaultFree(void* userData, void* ptr)
+{
+	free(ptr);
+}
+
+static void Allocator_Init()
+{
+	mtx_init(&state.lock, mtx_plain);
+	if (!state.allocator.alloc)
+	{
+		state.allocator.alloc = &Allocator_DefaultAlloc;
+		state.allocator.free = &Allocator_DefaultFree;
+		state.allocator.userData = NULL;
+	}
+}
+
+static AllocationHeader* Allocator_GetHeader(void* ptr)
+{
+	return (AllocationHeader*)ptr - 1;
+}
+
+void* Allocator_Alloc(size_t size)
+{
+	call_once(&stateInitFlag, &Allocator_Init);
+
+	// header is stored right before aligned memory, so that block can be freed and resized later
+	size_t total = size + sizeof(AllocationHeader) + MEMORY_ALIGNMENT - 1;
+	if (total < size)
+		return NULL;
+
+	void* block = state.allocator.alloc(state.allocator.userData, total, MEMORY_ALIGNMENT);
+	if (!block)
+		return NULL;
+
+	uintptr_t address = (uintptr_t)block + sizeof(AllocationHeader);
+	address = (address + MEMORY_ALIGNMENT - 1) & ~(uintptr_t)(MEMORY_ALIGNMENT - 1);
+
+	void* ptr = (void*)address;
+	AllocationHeader* header = Allocator_GetHeader(ptr);
+	header->block = block;
+	header->size = size;
+	atomic_fetch_add(&state.usage, size);
+	return ptr;
+}
+
+void* Allocator_Calloc(size_t count, size_t size)
+{
+	if (size && count > SIZE_MAX / size)
+		return NULL;
+
+	void* ptr = Allocator_Alloc(count * size);
+	if (ptr)
+		memset(ptr, 0, count * size);
+	return ptr;
+}
+
+void* Allocator_Realloc(void* ptr, size_t size)
+{
+	if (!ptr)
+		return Allocator_Alloc(size);
+
+	// allocator has no realloc, so contents are always moved
+	size_t oldSize = Allocator_GetHeader(ptr)->size;
+	void* tmp = Allocator_Alloc(size);
+	if (!tmp)
+		return NULL;
+
+	memcpy(tmp, ptr, oldSize < size ? oldSize : size);
+	Allocator_Free(ptr);
+	return tmp;
+}
+
+void Allocator_Free(void* ptr)
+{
+	if (!ptr)
+		return;
+
+	AllocationHeader* header = Allocator_GetHeader(ptr);
+	atomic_fetch_sub(&state.usage, header->size);
+	state.allocator.free(state.allocator.userData, header->block);
+}
+
+char* Allocator_StrDup(const char* str)
+{
+	size_t size = strlen(str) + 1;
+	char* copy = Allocator_Alloc(size);
+	if (copy)
+		memcpy(copy, str, size);
+	return copy;
+}
+
+static uint8_t* Allocator_TakeFrameBuffer(size_t size)
+{
+	mtx_lock(&state.lock);
+
+	// reuse idle buffer that is large enough, but not much larger than needed
+	for (IdleBuffer** it = &state.idleBuffers; *it; it = &(*it)->next)
+	{
+		size_t bufferSize = Allocator_GetHeader(*it)->size;
+		if (bufferSize >= size && bufferSize <= size + size / 4)
+		{
+			IdleBuffer* buffer = *it;
+			*it = buffer->next;
+			state.idleBytes -= bufferSize;
+			mtx_unlock(&state.lock);
+			return (uint8_t*)buffer;
+		}
+	}
+
+	mtx_unlock(&state.lock);
+	return Allocator_Alloc(size);
+}
+
+static void Allocator_TrimFrameBuffers(uint64_t idleLimit)
+{
+	// lock must be held
+	while (state.idleBuffers && state.idleBytes > idleLimit)
+	{
+		IdleBuffer* buffer = state.idleBuffers;
+		state.idleBuffers = buffer->next;
+		state.idleBytes -= Allocator_GetHeader(buffer)->size;
+		Allocator_Free(buffer);
+	}
+}
+
+static void Allocator_ReturnFrameBuffer(void* opaque, uint8_t* data)
+{
+	IdleBuffer* buffer = (IdleBuffer*)data;
+
+	mtx_lock(&state.lock);
+	buffer->next = state.idleBuffers;
+	state.idleBuffers = buffer;
+	state.idleBytes += Allocator_GetHeader(buffer)->size;
+
+	uint64_t idleLimit = FRAME_POOL_IDLE_LIMIT;
+	if (state.budget && atomic_load(&state.usage) > state.budget)
+		idleLimit = 0;
+	Allocator_TrimFrameBuffers(idleLimit);
+	mtx_unlock(&state.lock);
+}
+
+int Allocator_GetBuffer2(struct AVCodecContext* codec, struct AVFrame* frame, int flags)
+{
+	call_once(&stateInitFlag, &Allocator_Init);
+
+	const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(frame->format);
+	if (codec->codec_type != AVMEDIA_TYPE_VIDEO || !(codec->codec->capabilities & AV_CODEC_CAP_DR1) || !desc ||
+		(desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+	{
+		return avcodec_default_get_buffer2(codec, frame, flags);
+	}
+
+	int width = frame->width;
+	int height = frame->height;
+	int lineAlignment[AV_NUM_DATA_POINTERS];
+	avcodec_align_dimensions2(codec, &width, &height, lineAlignment);
+
+	// grow width until every line is aligned as decoder requires
+	int lineSize[4];
+	int isUnaligned;
+	do
+	{
+		if (av_image_fill_linesizes(lineSize, frame->format, width) < 0)
+			return AVERROR(EINVAL);
+		width += width & ~(width - 1);
+
+		isUnaligned = 0;
+		for (int i = 0; i < 4; i++)
+			isUnaligned |= lineAlignment[i] > 0 && lineSize[i] % lineAlignment[i];
+	} while (isUnaligned);
+
+	ptrdiff_t planeLineSize[4];
+	size_t planeSize[4];
+	for (int i = 0; i < 4; i++)
+		planeLineSize[i] = lineSize[i];
+	if (av_image_fill_plane_sizes(planeSize, frame->format, height, planeLineSize) < 0)
+		return AVERROR(EINVAL);
+
+	for (int i = 0; i < 4 && planeSize[i]; i++)
+	{
+		size_t size = planeSize[i] + FRAME_PADDING;
+		uint8_t* data = Allocator_TakeFrameBuffer(size);
+		frame->buf[i] = data ? av_buffer_create(data, (int)size, &Allocator_ReturnFrameBuffer, NULL, 0) : NULL;
+		if (!frame->buf[i])
+		{
+			if (data)
+				Allocator_ReturnFrameBuffer(NULL, data);
+			for (int j = 0; j < i; j++)
+				av_buffer_unref(&frame->buf[j]);
+			return AVERROR(ENOMEM);
+		}
+
+		frame->data[i] = frame->buf[i]->data;
+		frame->linesize[i] = lineSize[i];
+	}
+
+	frame->extended_data = frame->data;
+	return 0;
+}
+
+int Allocator_CheckBudget()
+{
+	call_once(&stateInitFlag, &Allocator_Init);
+
+	mtx_lock(&state.lock);
+	int ret = 0;
+	if (state.budget && atomic_load(&state.usage) >= state.budget)
+	{
+		// idle frame buffers are the only memory that can be given back right away
+		Allocator_TrimFrameBuffers(0);
+		if (atomic_load(&state.usage) >= state.budget)
+			ret = state.policy == BUDGET_POLICY_REFUSE ? -1 : 1;
+	}
+	mtx_unlock(&state.lock);
+	return ret;
+}
+
+int Allocator_SetAllocator(const MediaDecoderAllocator* allocator)
+{
+	call_once(&stateInitFlag, &Allocator_Init);
+
+	mtx_lock(&state.lock);
+	Allocator_TrimFrameBuffers(0);
+
+	// memory must be freed by same allocator that allocated it
+	int ret = -1;
+	if (atomic_load(&state.usage) == 0)
+	{
+		if (allocator && allocator->alloc && allocator->free)
+		{
+			state.allocator = *allocator;
+		}
+		else
+		{
+			state.allocator.alloc = &Allocator_DefaultAlloc;
+			state.allocator.free = &Allocator_DefaultFree;
+			state.allocator.userData = NULL;
+		}
+		ret = 0;
+	}
+	mtx_unlock(&state.lock);
+	return ret;
+}
+
+void Allocator_SetBudget(uint64_t bytes, MediaDecoderBudgetPolicy policy)
+{
+	call_once(&stateInitFlag, &Allocator_Init);
+
+	mtx_lock(&state.lock);
+	state.budget = bytes;
+	state.policy = policy;
+	mtx_unlock(&state.lock);
+}
+
+uint64_t Allocator_GetUsage()
+{
+	call_once(&stateInitFlag, &Allocator_Init);
+	return atomic_load(&state.usage);
+}
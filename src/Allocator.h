@@ -0,0 +1,33 @@
+#pragma once
+
+#include "MediaDecoder.h"
+#include <stddef.h>
+#include <stdint.h>
+
+struct AVCodecContext;
+struct AVFrame;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+	/// @brief Allocate memory through allocator set with MediaDecoder_SetAllocator, memory is 64 byte aligned
+	void* Allocator_Alloc(size_t size);
+	void* Allocator_Calloc(size_t count, size_t size);
+	void* Allocator_Realloc(void* ptr, size_t size);
+	void Allocator_Free(void* ptr);
+	char* Allocator_StrDup(const char* str);
+
+	/// @brief get_buffer2 callback of decoders, video frames are taken from a process wide pool of buffers
+	int Allocator_GetBuffer2(struct AVCodecContext* codec, struct AVFrame* frame, int flags);
+
+	/// @brief Check if memory budget allows new context to be opened
+	/// @return 0 if context can be opened normally, 1 if it should be degraded, -1 if it must be refused
+	int Allocator_CheckBudget();
+
+	int Allocator_SetAllocator(const MediaDecoderAllocator* allocator);
+	void Allocator_SetBudget(uint64_t bytes, MediaDecoderBudgetPolicy policy);
+	uint64_t Allocator_GetUsage();
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,183 @@
+#include "MediaDecoder.h"
+
+#include "Allocator.h"
+#include "Internal.h"
+#include "TaskQueue.h"
+#include <stdatomic.h>
+#include <threads.h>
+
+struct MediaDecoderOpenRequest
+{
+	char* url;
+	MediaDecoderOpenCallback callback;
+	void* userData;
+	// first frame is read right after opening, see MediaDecoder_PrerollAsync()
+	int readFirstFrame;
+
+	mtx_t lock;
+	cnd_t finished;
+	// set by whichever thread opens file, worker or caller of MediaDecoder_WaitOpen()
+	int isStarted;
+	int isDone;
+	atomic_int isCancelled;
+	MediaDecoderContext* context;
+
+	// request is shared by caller and worker, last one to let go of it frees it
+	int refCount;
+};
+
+static void AsyncOpen_Release(MediaDecoderOpenRequest* request)
+{
+	mtx_lock(&request->lock);
+	int refCount = --request->refCount;
+	mtx_unlock(&request->lock);
+	if (refCount > 0)
+		return;
+
+	// context of cancelled request was never taken by caller
+	if (request->context)
+		MediaDecoder_Close(&request->context);
+
+	cnd_destroy(&request->finished);
+	mtx_destroy(&request->lock);
+	Allocator_Free(request->url);
+	Allocator_Free(request);
+}
+
+static int AsyncOpen_Interrupt(void* opaque)
+{
+	MediaDecoderOpenRequest* request = (MediaDecoderOpenRequest*)opaque;
+	return atomic_load(&request->isCancelled);
+}
+
+static void AsyncOpen_Open(MediaDecoderOpenRequest* request)
+{
+	MediaDecoderContext* context = NULL;
+	if (!atomic_load(&request->isCancelled))
+	{
+		AVIOInterruptCB interrupt = {&AsyncOpen_Interrupt, request};
+		context = MediaDecoder_OpenInterruptible(request->url, &interrupt);
+	}
+
+	if (context && request->readFirstFrame && MediaDecoder_NextFrame(context, NULL) != 0)
+		MediaDecoder_Close(&context);
+
+	mtx_lock(&request->lock);
+	request->context = context;
+	request->isDone = 1;
+	cnd_broadcast(&request->finished);
+	mtx_unlock(&request->lock);
+
+	if (request->callback && !atomic_load(&request->isCancelled))
+		request->callback(request->userData, context ? 0 : -1);
+}
+
+static void AsyncOpen_Run(void* arg)
+{
+	MediaDecoderOpenRequest* request = (MediaDecoderOpenRequest*)arg;
+
+	mtx_lock(&request->lock);
+	int isStarted = request->isStarted;
+	request->isStarted = 1;
+	mtx_unlock(&request->lock);
+
+	if (!isStarted)
+		AsyncOpen_Open(request);
+	AsyncOpen_Release(request);
+}
+
+static MediaDecoderOpenRequest* AsyncOpen_Start(
+	const char* url, MediaDecoderOpenCallback callback, void* userData, int readFirstFrame
+)
+{
+	if (!url)
+		return NULL;
+
+	MediaDecoderOpenRequest* request = Allocator_Calloc(1, sizeof(*request));
+	if (!request)
+		return NULL;
+
+	request->url = Allocator_StrDup(url);
+	if (!request->url)
+	{
+		Allocator_Free(request);
+		return NULL;
+	}
+
+	request->callback = callback;
+	request->userData = userData;
+	request->readFirstFrame = readFirstFrame;
+	atomic_init(&request->isCancelled, 0);
+	request->refCount = 2;
+	mtx_init(&request->lock, mtx_plain);
+	cnd_init(&request->finished);
+
+	if (TaskQueue_Push(&AsyncOpen_Run, request))
+	{
+		cnd_destroy(&request->finished);
+		mtx_destroy(&request->lock);
+		Allocator_Free(request->url);
+		Allocator_Free(request);
+		return NULL;
+	}
+
+	return request;
+}
+
+MediaDecoderOpenRequest* MediaDecoder_OpenAsync(const char* url, MediaDecoderOpenCallback callback, void* userData)
+{
+	return AsyncOpen_Start(url, callback, userData, 0);
+}
+
+MediaDecoderOpenRequest* MediaDecoder_PrerollAsync(const char* url)
+{
+	return AsyncOpen_Start(url, NULL, NULL, 1);
+}
+
+int MediaDecoder_PollOpen(MediaDecoderOpenRequest* request)
+{
+	mtx_lock(&request->lock);
+	int isDone = request->isDone;
+	mtx_unlock(&request->lock);
+	return isDone;
+}
+
+MediaDecoderContext* MediaDecoder_WaitOpen(MediaDecoderOpenRequest** request)
+{
+	if (!request || !*request)
+		return NULL;
+
+	MediaDecoderOpenRequest* req = *request;
+	mtx_lock(&req->lock);
+	if (!req->isStarted)
+	{
+		// file is opened right here if no worker started on it yet. waiting could deadlock when caller itself runs
+		// on a worker, and all workers wait for requests that are queued behind them
+		req->isStarted = 1;
+		mtx_unlock(&req->lock);
+		AsyncOpen_Open(req);
+		mtx_lock(&req->lock);
+	}
+	while (!req->isDone)
+		cnd_wait(&req->finished, &req->lock);
+
+	// caller owns context from now on
+	MediaDecoderContext* context = req->context;
+	req->context = NULL;
+	mtx_unlock(&req->lock);
+
+	AsyncOpen_Release(req);
+	*request = NULL;
+	return context;
+}
+
+void MediaDecoder_CancelOpen(MediaDecoderOpenRequest** request)
+{
+	if (!request || !*request)
+		return;
+
+	// aborts reading of file, context is closed once worker is done with it
+	atomic_store(&(*request)->isCancelled, 1);
+	AsyncOpen_Release(*request);
+	*request = NULL;
+}
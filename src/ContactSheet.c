@@ -0,0 +1,219 @@
+#include "MediaDecoder.h"
+
+#include "ImageResizer.h"
+#include "Internal.h"
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+
+// without an index there is no way to know where keyframes are, so only seek when
+// target is far enough that decoding up to it would likely cost more than seeking
+#define CONTACT_SHEET_SEEK_DISTANCE 2.0
+
+typedef struct
+{
+	const MediaDecoderContactSheetInfo* sheet;
+	ImageResizerContext* resizer;
+	uint32_t stride;
+	int bytesPerPixel;
+} ContactSheetContext;
+
+static int ContactSheet_ShouldSeek(AVStream* stream, int64_t lastPts, int64_t target)
+{
+	if (lastPts == AV_NOPTS_VALUE)
+		return 1;
+	if (target <= lastPts)
+		return 0;
+
+	// seek only if there is a keyframe between current position and target
+	int index = av_index_search_timestamp(stream, target, AVSEEK_FLAG_BACKWARD);
+	if (index >= 0)
+	{
+		const AVIndexEntry* entry = avformat_index_get_entry(stream, index);
+		return entry && entry->timestamp > lastPts;
+	}
+
+	return (target - lastPts) * av_q2d(stream->time_base) > CONTACT_SHEET_SEEK_DISTANCE;
+}
+
+static uint8_t* ContactSheet_GetTile(ContactSheetContext* ctx, uint32_t tile)
+{
+	const MediaDecoderContactSheetInfo* sheet = ctx->sheet;
+	uint32_t x = tile % sheet->columns;
+	uint32_t y = tile / sheet->columns;
+	return sheet->frameBuffer + (size_t)y * sheet->tileHeight * ctx->stride +
+		   (size_t)x * sheet->tileWidth * ctx->bytesPerPixel;
+}
+
+static int ContactSheet_DrawTile(ContactSheetContext* ctx, const AVFrame* frame, uint32_t tile)
+{
+	const MediaDecoderContactSheetInfo* sheet = ctx->sheet;
+	if (!ImageResizer_SetParameters(
+			ctx->resizer, frame->width, frame->height, frame->format | 0x10000, sheet->tileWidth, sheet->tileHeight,
+			sheet->pixelFormat
+		))
+	{
+		return -1;
+	}
+
+	// scale directly into its place in contact sheet
+	uint8_t* outImageData[] = {ContactSheet_GetTile(ctx, tile), NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+	int outImageLineSize[] = {ctx->stride, 0, 0, 0, 0, 0, 0, 0};
+	ImageResizer_Resize(ctx->resizer, (const uint8_t**)frame->data, frame->linesize, outImageData, outImageLineSize);
+	return 0;
+}
+
+static void ContactSheet_CopyTile(ContactSheetContext* ctx, uint32_t srcTile, uint32_t dstTile)
+{
+	av_image_copy_plane(
+		ContactSheet_GetTile(ctx, dstTile), ctx->stride, ContactSheet_GetTile(ctx, srcTile), ctx->stride,
+		ctx->sheet->tileWidth * ctx->bytesPerPixel, ctx->sheet->tileHeight
+	);
+}
+
+int MediaDecoder_CreateContactSheet(const char* url, const MediaDecoderContactSheetInfo* sheet)
+{
+	if (!sheet || !sheet->frameBuffer || sheet->columns < 1 || sheet->rows < 1 || sheet->tileWidth < 1 ||
+		sheet->tileHeight < 1)
+	{
+		return -1;
+	}
+
+	ContactSheetContext ctx;
+	ctx.sheet = sheet;
+	ctx.bytesPerPixel = GetPixelFormatSize(sheet->pixelFormat);
+	if (ctx.bytesPerPixel < 1)
+		return -1;
+	ctx.stride = sheet->stride ? sheet->stride : sheet->columns * sheet->tileWidth * ctx.bytesPerPixel;
+
+	AVFormatContext* format = NULL;
+	if (avformat_open_input(&format, url, NULL, NULL) < 0)
+		return -1;
+
+	int streamIndex = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+	if (streamIndex < 0)
+	{
+		avformat_close_input(&format);
+		return -1;
+	}
+
+	// demuxer does not need to return packets of other streams
+	for (unsigned int i = 0; i < format->nb_streams; i++)
+	{
+		if (i != (unsigned int)streamIndex)
+			format->streams[i]->discard = AVDISCARD_ALL;
+	}
+
+	AVStream* stream = format->streams[streamIndex];
+	int previewLevel =
+		GetPreviewLevel(stream->codecpar->width, stream->codecpar->height, sheet->tileWidth, sheet->tileHeight);
+	AVCodecContext* codec = CreateDecoder(stream->codecpar, 0, previewLevel);
+	AVPacket* packet = av_packet_alloc();
+	AVFrame* frame = av_frame_alloc();
+	ctx.resizer = ImageResizer_CreateContext();
+	if (!codec || !packet || !frame || !ctx.resizer)
+	{
+		if (ctx.resizer)
+			ImageResizer_ReleaseContext(&ctx.resizer);
+		av_frame_free(&frame);
+		av_packet_free(&packet);
+		avcodec_free_context(&codec);
+		avformat_close_input(&format);
+		return -1;
+	}
+
+	int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+	int64_t duration = 0;
+	if (stream->duration != AV_NOPTS_VALUE)
+		duration = stream->duration;
+	else if (format->duration != AV_NOPTS_VALUE)
+		duration = av_rescale_q(format->duration, AV_TIME_BASE_Q, stream->time_base);
+
+	// frames before each target are only decoded because following frames depend on them
+	codec->skip_frame = AVDISCARD_NONREF;
+
+	uint32_t tileCount = sheet->columns * sheet->rows;
+	uint32_t tile = 0;
+	int frameCount = 0;
+	int64_t lastPts = AV_NOPTS_VALUE;
+	int isDraining = 0;
+	int ret = 0;
+	while (tile < tileCount)
+	{
+		// take frame from middle of each tile's time span
+		int64_t target = start + av_rescale(duration, 2 * tile + 1, 2 * (int64_t)tileCount);
+		if (!isDraining && ContactSheet_ShouldSeek(stream, lastPts, target))
+		{
+			if (avformat_seek_file(format, streamIndex, INT64_MIN, target, target, 0) >= 0)
+			{
+				avcodec_flush_buffers(codec);
+				lastPts = AV_NOPTS_VALUE;
+			}
+		}
+
+		// decode until frame at or after target is available
+		while (1)
+		{
+			ret = avcodec_receive_frame(codec, frame);
+			if (ret == 0)
+			{
+				lastPts = frame->best_effort_timestamp;
+				if (lastPts == AV_NOPTS_VALUE || lastPts >= target)
+					break;
+
+				av_frame_unref(frame);
+				continue;
+			}
+			if (ret != AVERROR(EAGAIN))
+				break;
+
+			ret = av_read_frame(format, packet);
+			if (ret < 0)
+			{
+				// no more packets, get remaining frames out of decoder
+				isDraining = 1;
+				avcodec_send_packet(codec, NULL);
+				continue;
+			}
+
+			if (packet->stream_index == streamIndex)
+				avcodec_send_packet(codec, packet);
+			av_packet_unref(packet);
+		}
+
+		if (ret != 0)
+			break;
+
+		// short media may have fewer frames than tiles, so one frame can cover several tiles
+		uint32_t firstTile = tile;
+		do
+		{
+			if (ContactSheet_DrawTile(&ctx, frame, tile))
+			{
+				ret = -1;
+				break;
+			}
+			tile++;
+		} while (tile < tileCount && lastPts != AV_NOPTS_VALUE &&
+				 lastPts >= start + av_rescale(duration, 2 * tile + 1, 2 * (int64_t)tileCount));
+		av_frame_unref(frame);
+		if (tile > firstTile)
+			frameCount++;
+
+		if (ret != 0)
+			break;
+	}
+
+	uint32_t drawnTiles = tile;
+	for (; tile < tileCount && drawnTiles > 0; tile++)
+		ContactSheet_CopyTile(&ctx, drawnTiles - 1, tile);
+
+	ImageResizer_ReleaseContext(&ctx.resizer);
+	av_frame_free(&frame);
+	av_packet_free(&packet);
+	avcodec_free_context(&codec);
+	avformat_close_input(&format);
+
+	// tiles that repeat a frame are not counted
+	return frameCount > 0 ? frameCount : -1;
+}
@@ -0,0 +1,208 @@
+#include "FrameCache.h"
+
+#include "Allocator.h"
+#include <libavutil/frame.h>
+#include <string.h>
+
+struct FrameCacheContext
+{
+	// sorted by pts
+	FrameCacheEntry* entries;
+	uint32_t count;
+	uint32_t capacity;
+
+	uint64_t bytes;
+	uint64_t budget;
+	// pts of last found or inserted frame, frames far away from it are evicted first
+	int64_t focusPts;
+};
+
+static uint64_t FrameCache_GetEntrySize(const FrameCacheEntry* entry)
+{
+	if (!entry->frame)
+		return entry->size;
+
+	uint64_t size = 0;
+	for (int i = 0; i < AV_NUM_DATA_POINTERS && entry->frame->buf[i]; i++)
+		size += entry->frame->buf[i]->size;
+	return size;
+}
+
+static void FrameCache_FreeEntry(FrameCacheEntry* entry)
+{
+	av_frame_free(&entry->frame);
+	Allocator_Free(entry->buffer);
+	entry->buffer = NULL;
+}
+
+static void FrameCache_Remove(FrameCacheContext* ctx, uint32_t index)
+{
+	FrameCacheEntry* entry = &ctx->entries[index];
+	ctx->bytes -= FrameCache_GetEntrySize(entry);
+	FrameCache_FreeEntry(entry);
+
+	memmove(entry, entry + 1, sizeof(*entry) * (ctx->count - index - 1));
+	ctx->count--;
+}
+
+static void FrameCache_Evict(FrameCacheContext* ctx)
+{
+	while (ctx->count > 1 && ctx->bytes > ctx->budget)
+	{
+		// entries are sorted, so entry farthest from focus is always first or last one
+		uint64_t distanceFirst = (uint64_t)(ctx->focusPts - ctx->entries[0].pts);
+		uint64_t distanceLast = (uint64_t)(ctx->entries[ctx->count - 1].pts - ctx->focusPts);
+		if (ctx->focusPts < ctx->entries[0].pts)
+			distanceFirst = 0;
+		if (ctx->focusPts > ctx->entries[ctx->count - 1].pts)
+			distanceLast = 0;
+		FrameCache_Remove(ctx, distanceFirst >= distanceLast ? 0 : ctx->count - 1);
+	}
+}
+
+/// @return index of first entry with pts greater or equal to pts
+static uint32_t FrameCache_LowerBound(FrameCacheContext* ctx, int64_t pts)
+{
+	uint32_t first = 0;
+	uint32_t count = ctx->count;
+	while (count > 0)
+	{
+		uint32_t step = count / 2;
+		if (ctx->entries[first + step].pts < pts)
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+		{
+			count = step;
+		}
+	}
+	return first;
+}
+
+static bool FrameCache_Insert(FrameCacheContext* ctx, FrameCacheEntry* newEntry)
+{
+	if (FrameCache_Update(ctx, newEntry->pts, newEntry->prevPts))
+	{
+		FrameCache_FreeEntry(newEntry);
+		return true;
+	}
+
+	uint32_t index = FrameCache_LowerBound(ctx, newEntry->pts);
+	FrameCacheEntry* prev = index > 0 ? &ctx->entries[index - 1] : NULL;
+	if (prev && prev->pts == newEntry->prevPts)
+		prev->nextPts = newEntry->pts;
+
+	if (ctx->count == ctx->capacity)
+	{
+		uint32_t capacity = ctx->capacity ? ctx->capacity * 2 : 64;
+		FrameCacheEntry* tmp = Allocator_Realloc(ctx->entries, sizeof(*tmp) * capacity);
+		if (!tmp)
+		{
+			FrameCache_FreeEntry(newEntry);
+			return false;
+		}
+		ctx->entries = tmp;
+		ctx->capacity = capacity;
+	}
+
+	FrameCacheEntry* entry = &ctx->entries[index];
+	memmove(entry + 1, entry, sizeof(*entry) * (ctx->count - index));
+	*entry = *newEntry;
+	ctx->count++;
+
+	ctx->bytes += FrameCache_GetEntrySize(entry);
+	ctx->focusPts = entry->pts;
+	FrameCache_Evict(ctx);
+	return true;
+}
+
+FrameCacheContext* FrameCache_CreateContext()
+{
+	FrameCacheContext* ctx = Allocator_Calloc(1, sizeof(*ctx));
+	return ctx;
+}
+
+void FrameCache_ReleaseContext(FrameCacheContext** context)
+{
+	FrameCache_Clear(*context);
+	Allocator_Free((*context)->entries);
+	Allocator_Free(*context);
+	*context = NULL;
+}
+
+void FrameCache_SetBudget(FrameCacheContext* context, uint64_t bytes)
+{
+	context->budget = bytes;
+	FrameCache_Evict(context);
+}
+
+uint64_t FrameCache_GetBudget(FrameCacheContext* context)
+{
+	return context->budget;
+}
+
+void FrameCache_Clear(FrameCacheContext* context)
+{
+	for (uint32_t i = 0; i < context->count; i++)
+		FrameCache_FreeEntry(&context->entries[i]);
+	context->count = 0;
+	context->bytes = 0;
+}
+
+bool FrameCache_Update(FrameCacheContext* context, int64_t pts, int64_t prevPts)
+{
+	uint32_t index = FrameCache_LowerBound(context, pts);
+	if (index >= context->count || context->entries[index].pts != pts)
+		return false;
+
+	// frame was already cached, only learn about its neighbour
+	FrameCacheEntry* prev = index > 0 ? &context->entries[index - 1] : NULL;
+	if (prev && prev->pts == prevPts)
+		prev->nextPts = pts;
+	if (prevPts != AV_NOPTS_VALUE)
+		context->entries[index].prevPts = prevPts;
+	return true;
+}
+
+bool FrameCache_InsertFrame(
+	FrameCacheContext* context, const struct AVFrame* frame, int64_t pts, int64_t duration, int64_t prevPts
+)
+{
+	FrameCacheEntry entry = {pts, duration, prevPts, AV_NOPTS_VALUE, NULL, NULL, 0};
+	entry.frame = av_frame_clone(frame);
+	if (!entry.frame)
+		return false;
+	return FrameCache_Insert(context, &entry);
+}
+
+bool FrameCache_InsertImage(
+	FrameCacheContext* context, const uint8_t* buffer, uint32_t size, int64_t pts, int64_t duration, int64_t prevPts
+)
+{
+	FrameCacheEntry entry = {pts, duration, prevPts, AV_NOPTS_VALUE, NULL, NULL, size};
+	entry.buffer = Allocator_Alloc(size);
+	if (!entry.buffer)
+		return false;
+	memcpy(entry.buffer, buffer, size);
+	return FrameCache_Insert(context, &entry);
+}
+
+const FrameCacheEntry* FrameCache_Find(FrameCacheContext* context, int64_t pts)
+{
+	// last frame that starts at or before pts
+	uint32_t index = FrameCache_LowerBound(context, pts);
+	if (index < context->count && context->entries[index].pts == pts)
+		index++;
+	if (index == 0)
+		return NULL;
+
+	const FrameCacheEntry* entry = &context->entries[index - 1];
+	bool isShown = pts < entry->pts + entry->duration || (entry->nextPts != AV_NOPTS_VALUE && pts < entry->nextPts);
+	if (!isShown)
+		return NULL;
+
+	context->focusPts = entry->pts;
+	return entry;
+}
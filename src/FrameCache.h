@@ -0,0 +1,59 @@
+#pragma once
+
+#include "MediaDecoder.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+struct AVFrame;
+
+typedef struct FrameCacheContext FrameCacheContext;
+
+typedef struct FrameCacheEntry
+{
+	int64_t pts;
+	int64_t duration;
+	// pts of frames that were decoded right before and after this one, AV_NOPTS_VALUE if unknown
+	int64_t prevPts;
+	int64_t nextPts;
+
+	// either decoded frame or converted image is stored
+	struct AVFrame* frame;
+	uint8_t* buffer;
+	uint32_t size;
+} FrameCacheEntry;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+	FrameCacheContext* FrameCache_CreateContext();
+	void FrameCache_ReleaseContext(FrameCacheContext** context);
+
+	/// @brief Set maximum amount of memory used by cached frames, frames farthest from last used frame are evicted
+	void FrameCache_SetBudget(FrameCacheContext* context, uint64_t bytes);
+	uint64_t FrameCache_GetBudget(FrameCacheContext* context);
+	void FrameCache_Clear(FrameCacheContext* context);
+
+	/// @brief Store reference to decoded frame
+	/// @param prevPts pts of frame that was decoded right before this one, AV_NOPTS_VALUE if there is none
+	bool FrameCache_InsertFrame(
+		FrameCacheContext* context, const struct AVFrame* frame, int64_t pts, int64_t duration, int64_t prevPts
+	);
+
+	/// @brief Record neighbour of frame that is already cached, so that it does not have to be inserted again
+	/// @return true if frame at pts is cached
+	bool FrameCache_Update(FrameCacheContext* context, int64_t pts, int64_t prevPts);
+
+	/// @brief Store copy of converted image
+	/// @param prevPts pts of frame that was decoded right before this one, AV_NOPTS_VALUE if there is none
+	bool FrameCache_InsertImage(
+		FrameCacheContext* context, const uint8_t* buffer, uint32_t size, int64_t pts, int64_t duration,
+		int64_t prevPts
+	);
+
+	/// @brief Find frame that is shown at pts
+	/// @return entry, which stays valid until next insert, or NULL
+	const FrameCacheEntry* FrameCache_Find(FrameCacheContext* context, int64_t pts);
+#ifdef __cplusplus
+}
+#endif
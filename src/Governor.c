@@ -0,0 +1,146 @@
+#include "Governor.h"
+
+#include "Allocator.h"
+#include <libavutil/time.h>
+#include <threads.h>
+
+#define DEFAULT_TARGET_LOAD 0.8
+// weight of newest frame in smoothed load
+#define LOAD_SMOOTHING 0.1
+// load must stay below this fraction of target load before quality is raised again
+#define STEP_UP_RATIO 0.6
+// seconds load must stay over target before stepping down, and below step up threshold before stepping up. stepping
+// up waits much longer, so that level does not flip back and forth when load is close to target
+#define STEP_DOWN_DELAY 0.5
+#define STEP_UP_DELAY 3.0
+
+struct MediaDecoderGovernor
+{
+	mtx_t lock;
+	int refCount;
+
+	double targetLoad;
+	MediaDecoderGovernorInfo info;
+
+	// seconds at which load went over target or below step up threshold, negative while it is not
+	double overSince;
+	double underSince;
+	double lastChange;
+};
+
+static double Governor_GetTime()
+{
+	return av_gettime_relative() / 1000000.0;
+}
+
+static void Governor_Update(MediaDecoderGovernor* governor, double now)
+{
+	// lock must be held
+	MediaDecoderGovernorInfo* info = &governor->info;
+	if (info->load > governor->targetLoad)
+	{
+		if (governor->overSince < 0.0)
+			governor->overSince = now;
+		if (info->level < GOVERNOR_LEVEL_HALF_RATE && now - governor->overSince >= STEP_DOWN_DELAY &&
+			now - governor->lastChange >= STEP_DOWN_DELAY)
+		{
+			info->level++;
+			info->stepDownCount++;
+			governor->lastChange = now;
+			governor->overSince = -1.0;
+		}
+	}
+	else
+	{
+		governor->overSince = -1.0;
+	}
+
+	if (info->load < governor->targetLoad * STEP_UP_RATIO)
+	{
+		if (governor->underSince < 0.0)
+			governor->underSince = now;
+		if (info->level > GOVERNOR_LEVEL_FULL && now - governor->underSince >= STEP_UP_DELAY &&
+			now - governor->lastChange >= STEP_UP_DELAY)
+		{
+			info->level--;
+			info->stepUpCount++;
+			governor->lastChange = now;
+			governor->underSince = -1.0;
+		}
+	}
+	else
+	{
+		governor->underSince = -1.0;
+	}
+}
+
+void Governor_Retain(MediaDecoderGovernor* governor)
+{
+	mtx_lock(&governor->lock);
+	governor->refCount++;
+	mtx_unlock(&governor->lock);
+}
+
+void Governor_Release(MediaDecoderGovernor* governor)
+{
+	mtx_lock(&governor->lock);
+	int refCount = --governor->refCount;
+	mtx_unlock(&governor->lock);
+	if (refCount > 0)
+		return;
+
+	mtx_destroy(&governor->lock);
+	Allocator_Free(governor);
+}
+
+MediaDecoderGovernorLevel Governor_Report(MediaDecoderGovernor* governor, double cost, double interval)
+{
+	if (interval <= 0.0)
+		return governor->info.level;
+
+	double now = Governor_GetTime();
+	mtx_lock(&governor->lock);
+
+	// contexts of a pool report into same load, so that all of them change level together
+	MediaDecoderGovernorInfo* info = &governor->info;
+	info->load += (cost / interval - info->load) * LOAD_SMOOTHING;
+	Governor_Update(governor, now);
+
+	MediaDecoderGovernorLevel level = info->level;
+	mtx_unlock(&governor->lock);
+	return level;
+}
+
+MediaDecoderGovernor* MediaDecoder_CreateGovernor(double targetLoad)
+{
+	MediaDecoderGovernor* governor = Allocator_Calloc(1, sizeof(*governor));
+	if (!governor)
+		return NULL;
+
+	mtx_init(&governor->lock, mtx_plain);
+	governor->refCount = 1;
+	governor->targetLoad = targetLoad > 0.0 ? targetLoad : DEFAULT_TARGET_LOAD;
+	governor->info.level = GOVERNOR_LEVEL_FULL;
+	governor->overSince = -1.0;
+	governor->underSince = -1.0;
+	governor->lastChange = Governor_GetTime();
+	return governor;
+}
+
+void MediaDecoder_ReleaseGovernor(MediaDecoderGovernor** governor)
+{
+	if (!governor || !*governor)
+		return;
+
+	// attached contexts keep using it until they are closed
+	Governor_Release(*governor);
+	*governor = NULL;
+}
+
+MediaDecoderGovernorInfo MediaDecoder_GetGovernorInfo(MediaDecoderGovernor* governor)
+{
+	mtx_lock(&governor->lock);
+	MediaDecoderGovernorInfo info = governor->info;
+	mtx_unlock(&governor->lock);
+	return info;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "MediaDecoder.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+	void Governor_Retain(MediaDecoderGovernor* governor);
+	void Governor_Release(MediaDecoderGovernor* governor);
+
+	/// @brief Add cost of one decoded video frame to load of governor
+	/// @param cost seconds spent on decoding and converting frame
+	/// @param interval seconds frame is shown
+	/// @return level that following frames should be decoded at
+	MediaDecoderGovernorLevel Governor_Report(MediaDecoderGovernor* governor, double cost, double interval);
+#ifdef __cplusplus
+}
+#endif
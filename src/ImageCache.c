@@ -0,0 +1,304 @@
+#include "ImageCache.h"
+
+#include "Allocator.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <threads.h>
+
+#define IMAGE_CACHE_BUCKET_COUNT 256
+
+struct ImageCacheEntry
+{
+	char* path;
+	int64_t modifiedTime;
+	int width;
+	int height;
+	enum MediaDecoderPixelFormat format;
+	uint32_t hash;
+
+	uint8_t* data;
+	uint32_t size;
+	uint32_t refCount;
+
+	// least recently used entries are at the end of the list
+	ImageCacheEntry* prev;
+	ImageCacheEntry* next;
+	ImageCacheEntry* nextInBucket;
+};
+
+typedef struct
+{
+	mtx_t lock;
+	ImageCacheEntry* buckets[IMAGE_CACHE_BUCKET_COUNT];
+	ImageCacheEntry* head;
+	ImageCacheEntry* tail;
+	MediaDecoderImageCacheStats stats;
+	// bytes of entries that no context uses, only these count against budget
+	uint64_t bytesUnused;
+} ImageCache;
+
+static ImageCache cache;
+static once_flag cacheInitFlag = ONCE_FLAG_INIT;
+
+static void ImageCache_Init()
+{
+	mtx_init(&cache.lock, mtx_plain);
+}
+
+static uint32_t ImageCache_Hash(const char* path, int64_t modifiedTime, int width, int height, int format)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (const char* c = path; *c; c++)
+		hash = (hash ^ (uint8_t)*c) * 16777619u;
+
+	int64_t values[] = {modifiedTime, width, height, format};
+	const uint8_t* bytes = (const uint8_t*)values;
+	for (size_t i = 0; i < sizeof(values); i++)
+		hash = (hash ^ bytes[i]) * 16777619u;
+
+	return hash;
+}
+
+static bool ImageCache_GetModifiedTime(const char* path, int64_t* modifiedTime)
+{
+	// only local files can be validated, anything else is never cached
+	struct stat st;
+	if (stat(path, &st) != 0)
+		return false;
+
+	*modifiedTime = (int64_t)st.st_mtime;
+	return true;
+}
+
+static void ImageCache_Unlink(ImageCacheEntry* entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		cache.head = entry->next;
+
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		cache.tail = entry->prev;
+
+	entry->prev = entry->next = NULL;
+}
+
+static void ImageCache_PushFront(ImageCacheEntry* entry)
+{
+	entry->prev = NULL;
+	entry->next = cache.head;
+	if (cache.head)
+		cache.head->prev = entry;
+	cache.head = entry;
+	if (!cache.tail)
+		cache.tail = entry;
+}
+
+static ImageCacheEntry* ImageCache_Find(
+	uint32_t hash, const char* path, int64_t modifiedTime, int width, int height, enum MediaDecoderPixelFormat format
+)
+{
+	for (ImageCacheEntry* e = cache.buckets[hash % IMAGE_CACHE_BUCKET_COUNT]; e; e = e->nextInBucket)
+	{
+		if (e->hash == hash && e->modifiedTime == modifiedTime && e->width == width && e->height == height &&
+			e->format == format && !strcmp(e->path, path))
+		{
+			return e;
+		}
+	}
+	return NULL;
+}
+
+static void ImageCache_Remove(ImageCacheEntry* entry)
+{
+	ImageCacheEntry** link = &cache.buckets[entry->hash % IMAGE_CACHE_BUCKET_COUNT];
+	while (*link != entry)
+		link = &(*link)->nextInBucket;
+	*link = entry->nextInBucket;
+
+	ImageCache_Unlink(entry);
+	cache.stats.bytesResident -= entry->size;
+	cache.stats.entryCount--;
+	if (entry->refCount == 0)
+		cache.bytesUnused -= entry->size;
+
+	Allocator_Free(entry->data);
+	Allocator_Free(entry->path);
+	Allocator_Free(entry);
+}
+
+static void ImageCache_Evict()
+{
+	// images that are still in use do not count against budget, they are kept until they are released
+	ImageCacheEntry* entry = cache.tail;
+	while (entry && cache.bytesUnused > cache.stats.budget)
+	{
+		ImageCacheEntry* prev = entry->prev;
+		if (entry->refCount == 0)
+		{
+			ImageCache_Remove(entry);
+			cache.stats.evictions++;
+		}
+		entry = prev;
+	}
+}
+
+ImageCacheEntry* ImageCache_Acquire(const char* path, int width, int height, enum MediaDecoderPixelFormat format)
+{
+	call_once(&cacheInitFlag, ImageCache_Init);
+
+	int64_t modifiedTime;
+	if (!path || !ImageCache_GetModifiedTime(path, &modifiedTime))
+		return NULL;
+
+	uint32_t hash = ImageCache_Hash(path, modifiedTime, width, height, format);
+
+	mtx_lock(&cache.lock);
+	if (cache.stats.budget == 0)
+	{
+		mtx_unlock(&cache.lock);
+		return NULL;
+	}
+
+	ImageCacheEntry* entry = ImageCache_Find(hash, path, modifiedTime, width, height, format);
+	if (entry)
+	{
+		if (entry->refCount++ == 0)
+			cache.bytesUnused -= entry->size;
+		ImageCache_Unlink(entry);
+		ImageCache_PushFront(entry);
+		cache.stats.hits++;
+	}
+	else
+	{
+		cache.stats.misses++;
+	}
+	mtx_unlock(&cache.lock);
+
+	return entry;
+}
+
+ImageCacheEntry* ImageCache_Insert(
+	const char* path, int width, int height, enum MediaDecoderPixelFormat format, uint8_t* buffer, uint32_t size
+)
+{
+	call_once(&cacheInitFlag, ImageCache_Init);
+
+	int64_t modifiedTime;
+	if (!path || !ImageCache_GetModifiedTime(path, &modifiedTime))
+		return NULL;
+
+	uint32_t hash = ImageCache_Hash(path, modifiedTime, width, height, format);
+
+	mtx_lock(&cache.lock);
+	if (size > cache.stats.budget)
+	{
+		mtx_unlock(&cache.lock);
+		return NULL;
+	}
+
+	ImageCacheEntry* entry = ImageCache_Find(hash, path, modifiedTime, width, height, format);
+	if (entry)
+	{
+		// same image was converted by another context in the meantime
+		if (entry->refCount++ == 0)
+			cache.bytesUnused -= entry->size;
+		ImageCache_Unlink(entry);
+		ImageCache_PushFront(entry);
+		mtx_unlock(&cache.lock);
+
+		Allocator_Free(buffer);
+		return entry;
+	}
+
+	entry = Allocator_Alloc(sizeof(*entry));
+	char* pathCopy = Allocator_StrDup(path);
+	if (!entry || !pathCopy)
+	{
+		mtx_unlock(&cache.lock);
+		Allocator_Free(entry);
+		Allocator_Free(pathCopy);
+		return NULL;
+	}
+
+	entry->path = pathCopy;
+	entry->modifiedTime = modifiedTime;
+	entry->width = width;
+	entry->height = height;
+	entry->format = format;
+	entry->hash = hash;
+	entry->data = buffer;
+	entry->size = size;
+	entry->refCount = 1;
+
+	entry->nextInBucket = cache.buckets[hash % IMAGE_CACHE_BUCKET_COUNT];
+	cache.buckets[hash % IMAGE_CACHE_BUCKET_COUNT] = entry;
+	ImageCache_PushFront(entry);
+	cache.stats.bytesResident += size;
+	cache.stats.entryCount++;
+
+	ImageCache_Evict();
+	mtx_unlock(&cache.lock);
+
+	return entry;
+}
+
+uint8_t* ImageCache_GetData(ImageCacheEntry* entry)
+{
+	return entry->data;
+}
+
+uint32_t ImageCache_GetSize(ImageCacheEntry* entry)
+{
+	return entry->size;
+}
+
+int ImageCache_GetWidth(ImageCacheEntry* entry)
+{
+	return entry->width;
+}
+
+int ImageCache_GetHeight(ImageCacheEntry* entry)
+{
+	return entry->height;
+}
+
+void ImageCache_Release(ImageCacheEntry** entry)
+{
+	if (!entry || !*entry)
+		return;
+
+	mtx_lock(&cache.lock);
+	if (--(*entry)->refCount == 0)
+		cache.bytesUnused += (*entry)->size;
+	ImageCache_Evict();
+	mtx_unlock(&cache.lock);
+
+	*entry = NULL;
+}
+
+void ImageCache_SetBudget(uint64_t bytes)
+{
+	call_once(&cacheInitFlag, ImageCache_Init);
+
+	mtx_lock(&cache.lock);
+	cache.stats.budget = bytes;
+	ImageCache_Evict();
+	mtx_unlock(&cache.lock);
+}
+
+MediaDecoderImageCacheStats ImageCache_GetStats()
+{
+	call_once(&cacheInitFlag, ImageCache_Init);
+
+	mtx_lock(&cache.lock);
+	MediaDecoderImageCacheStats stats = cache.stats;
+	mtx_unlock(&cache.lock);
+
+	return stats;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "MediaDecoder.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct ImageCacheEntry ImageCacheEntry;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+	/// @brief Find already converted image
+	/// @return referenced entry or NULL if image is not cached
+	ImageCacheEntry* ImageCache_Acquire(
+		const char* path, int width, int height, enum MediaDecoderPixelFormat format
+	);
+
+	/// @brief Store converted image, cache takes ownership of buffer
+	/// @return referenced entry or NULL if image could not be cached, in which case caller still owns buffer
+	ImageCacheEntry* ImageCache_Insert(
+		const char* path, int width, int height, enum MediaDecoderPixelFormat format, uint8_t* buffer, uint32_t size
+	);
+
+	uint8_t* ImageCache_GetData(ImageCacheEntry* entry);
+	uint32_t ImageCache_GetSize(ImageCacheEntry* entry);
+	int ImageCache_GetWidth(ImageCacheEntry* entry);
+	int ImageCache_GetHeight(ImageCacheEntry* entry);
+
+	void ImageCache_Release(ImageCacheEntry** entry);
+
+	void ImageCache_SetBudget(uint64_t bytes);
+	MediaDecoderImageCacheStats ImageCache_GetStats();
+#ifdef __cplusplus
+}
+#endif
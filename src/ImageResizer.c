@@ -1,6 +1,21 @@
 #include "ImageResizer.h"
+#include "Allocator.h"
 #include "Internal.h"
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libswscale/swscale.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_RESIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+#define MAX_MIP_LEVELS 16
+
+// number of input rows converted at once when generating mip levels, small enough
+// that converted rows are still in cache when they are downsampled
+#define MIP_BAND_HEIGHT 16
 
 typedef struct
 {
@@ -11,6 +26,21 @@ typedef struct
 	int cacheOutWidth;
 	int cacheOutHeight;
 	enum MediaDecoderPixelFormat cacheOutFormat;
+	int cacheFlags;
+	enum MediaDecoderScaleQuality quality;
+
+	// input already matches output, so frame is only copied
+	bool isPassthrough;
+	enum AVPixelFormat passthroughFormat;
+	int inChromaShift;
+
+	const MediaDecoderPlaneInfo* mipLevels;
+	int mipLevelCount;
+	enum MediaDecoderMipFilter mipFilter;
+	int mipChannels;
+	int mipRowsDone[MAX_MIP_LEVELS];
+	uint16_t* mipRow;
+	int mipRowCapacity;
 } InternalState;
 
 static enum AVPixelFormat FixDeprecatedFormat(enum AVPixelFormat format)
@@ -36,9 +66,34 @@ static enum AVPixelFormat FixDeprecatedFormat(enum AVPixelFormat format)
 	return format;
 }
 
+static int GetScaleFlags(enum MediaDecoderScaleQuality quality, int inWidth, int inHeight, int outWidth, int outHeight)
+{
+	switch (quality)
+	{
+	case SCALE_QUALITY_FAST_BILINEAR:
+		return SWS_FAST_BILINEAR;
+	case SCALE_QUALITY_POINT:
+		return SWS_POINT;
+	case SCALE_QUALITY_BILINEAR:
+		return SWS_BILINEAR;
+	case SCALE_QUALITY_BICUBIC:
+		return SWS_BICUBIC;
+	case SCALE_QUALITY_AREA:
+		return SWS_AREA;
+	case SCALE_QUALITY_LANCZOS:
+		return SWS_LANCZOS;
+
+	default:
+		// bilinear filter skips source pixels when shrinking more than 2x, area averages all of them
+		if (outWidth * 2 < inWidth || outHeight * 2 < inHeight)
+			return SWS_AREA;
+		return SWS_BILINEAR;
+	}
+}
+
 ImageResizerContext* ImageResizer_CreateContext()
 {
-	InternalState* ctx = malloc(sizeof(*ctx));
+	InternalState* ctx = Allocator_Alloc(sizeof(*ctx));
 	ctx->ctxScale = NULL;
 	ctx->cacheInWidth = -1;
 	ctx->cacheInHeight = -1;
@@ -46,6 +101,17 @@ ImageResizerContext* ImageResizer_CreateContext()
 	ctx->cacheOutWidth = -1;
 	ctx->cacheOutHeight = -1;
 	ctx->cacheOutFormat = PIXEL_FORMAT_UNKNOWN;
+	ctx->cacheFlags = 0;
+	ctx->quality = SCALE_QUALITY_AUTO;
+	ctx->isPassthrough = false;
+	ctx->passthroughFormat = AV_PIX_FMT_NONE;
+	ctx->inChromaShift = 0;
+	ctx->mipLevels = NULL;
+	ctx->mipLevelCount = 0;
+	ctx->mipFilter = MIP_FILTER_BOX;
+	ctx->mipChannels = 0;
+	ctx->mipRow = NULL;
+	ctx->mipRowCapacity = 0;
 
 	return (ImageResizerContext*)ctx;
 }
@@ -68,12 +134,15 @@ bool ImageResizer_SetParameters(
 	inFormatRaw = FixDeprecatedFormat(inFormatRaw);
 	outFormatRaw = FixDeprecatedFormat(outFormatRaw);
 
-	if (ctx->ctxScale)
+	int flags = GetScaleFlags(ctx->quality, inWidth, inHeight, outWidth, outHeight);
+
+	if (ctx->ctxScale || ctx->isPassthrough)
 	{
 		if (inWidth == ctx->cacheInWidth && inHeight == ctx->cacheInHeight && inFormat == ctx->cacheInFormat &&
-			outWidth == ctx->cacheOutWidth && outHeight == ctx->cacheOutHeight && outFormat == ctx->cacheOutFormat)
+			outWidth == ctx->cacheOutWidth && outHeight == ctx->cacheOutHeight && outFormat == ctx->cacheOutFormat &&
+			flags == ctx->cacheFlags)
 		{
-			return ctx->ctxScale;
+			return true;
 		}
 	}
 
@@ -83,21 +152,298 @@ bool ImageResizer_SetParameters(
 	ctx->cacheOutWidth = outWidth;
 	ctx->cacheOutHeight = outHeight;
 	ctx->cacheOutFormat = outFormat;
+	ctx->cacheFlags = flags;
 
 	sws_freeContext(ctx->ctxScale);
+	ctx->ctxScale = NULL;
+
+	// decoder already produces what was requested, no need for swscale
+	ctx->isPassthrough = inFormatRaw == outFormatRaw && inWidth == outWidth && inHeight == outHeight;
+	ctx->passthroughFormat = outFormatRaw;
+
+	const AVPixFmtDescriptor* inDesc = av_pix_fmt_desc_get(inFormatRaw);
+	ctx->inChromaShift = inDesc ? inDesc->log2_chroma_h : 0;
+
+	if (ctx->isPassthrough)
+		return true;
+
 	ctx->ctxScale = sws_getContext(
-		inWidth, inHeight, inFormatRaw, outWidth, outHeight, outFormatRaw, SWS_BILINEAR, NULL, NULL, NULL
+		inWidth, inHeight, inFormatRaw, outWidth, outHeight, outFormatRaw, flags, NULL, NULL, NULL
 	);
 
 	return ctx->ctxScale != NULL;
 }
 
+void ImageResizer_SetQuality(ImageResizerContext* context, enum MediaDecoderScaleQuality quality)
+{
+	InternalState* ctx = (InternalState*)context;
+	ctx->quality = quality;
+}
+
+bool ImageResizer_SetMipChain(
+	ImageResizerContext* context, const MediaDecoderPlaneInfo* levels, int levelCount,
+	enum MediaDecoderMipFilter filter
+)
+{
+	InternalState* ctx = (InternalState*)context;
+	ctx->mipLevels = NULL;
+	ctx->mipLevelCount = 0;
+
+	if (!levels || levelCount < 1)
+		return true;
+	if (levelCount > MAX_MIP_LEVELS)
+		return false;
+
+	// only 8bit packed formats can be downsampled
+	int channels = GetPixelFormatSize(ctx->cacheOutFormat);
+	if (channels != 1 && channels != 3 && channels != 4)
+		return false;
+
+	int width = ctx->cacheOutWidth;
+	int height = ctx->cacheOutHeight;
+	for (int i = 0; i < levelCount; i++)
+	{
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		if (!levels[i].data || levels[i].width != width || levels[i].height != height ||
+			levels[i].stride < (uint32_t)(width * channels))
+		{
+			return false;
+		}
+	}
+
+	if (ctx->mipRowCapacity < ctx->cacheOutWidth * channels)
+	{
+		uint16_t* tmp = Allocator_Realloc(ctx->mipRow, sizeof(*tmp) * ctx->cacheOutWidth * channels);
+		if (!tmp)
+			return false;
+		ctx->mipRow = tmp;
+		ctx->mipRowCapacity = ctx->cacheOutWidth * channels;
+	}
+
+	ctx->mipLevels = levels;
+	ctx->mipLevelCount = levelCount;
+	ctx->mipFilter = filter;
+	ctx->mipChannels = channels;
+	return true;
+}
+
+static const uint8_t* GetMipRow(const MediaDecoderPlaneInfo* plane, int y)
+{
+	if (y < 0)
+		y = 0;
+	else if (y >= (int)plane->height)
+		y = plane->height - 1;
+	return plane->data + (size_t)y * plane->stride;
+}
+
+static void DownsampleRowBox(
+	const uint8_t* row0, const uint8_t* row1, int srcWidth, uint8_t* dst, int dstWidth, int channels
+)
+{
+	int x = 0;
+#ifdef IMAGE_RESIZER_SSE2
+	if (channels == 4)
+	{
+		// 4 source pixels of both rows are averaged into 2 output pixels per iteration
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi16(2);
+		for (; x + 2 <= dstWidth && 2 * x + 4 <= srcWidth; x += 2)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+			__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+			__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+			lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+			hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+			__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+			_mm_storel_epi64((__m128i*)(dst + x * 4), _mm_packus_epi16(sum, sum));
+		}
+	}
+#endif
+
+	for (; x < dstWidth; x++)
+	{
+		int x0 = 2 * x * channels;
+		int x1 = (2 * x + 1 < srcWidth ? 2 * x + 1 : srcWidth - 1) * channels;
+		for (int c = 0; c < channels; c++)
+		{
+			int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+			dst[x * channels + c] = (uint8_t)((sum + 2) >> 2);
+		}
+	}
+}
+
+static void DownsamplePixelBilinear(const uint16_t* tmp, int srcWidth, uint8_t* dst, int x, int channels)
+{
+	int x0 = (2 * x - 1 < 0 ? 0 : 2 * x - 1) * channels;
+	int x1 = 2 * x * channels;
+	int x2 = (2 * x + 1 < srcWidth ? 2 * x + 1 : srcWidth - 1) * channels;
+	int x3 = (2 * x + 2 < srcWidth ? 2 * x + 2 : srcWidth - 1) * channels;
+	for (int c = 0; c < channels; c++)
+	{
+		int sum = tmp[x0 + c] + 3 * (tmp[x1 + c] + tmp[x2 + c]) + tmp[x3 + c];
+		dst[x * channels + c] = (uint8_t)((sum + 32) >> 6);
+	}
+}
+
+static void DownsampleRowBilinear(
+	const uint8_t* const* rows, int srcWidth, uint8_t* dst, int dstWidth, int channels, uint16_t* tmp
+)
+{
+	// separable 1 3 3 1 tent filter, vertical pass first. sums stay below 16 bits in both passes
+	int count = srcWidth * channels;
+	int i = 0;
+#ifdef IMAGE_RESIZER_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i r0 = _mm_loadu_si128((const __m128i*)(rows[0] + i));
+		__m128i r1 = _mm_loadu_si128((const __m128i*)(rows[1] + i));
+		__m128i r2 = _mm_loadu_si128((const __m128i*)(rows[2] + i));
+		__m128i r3 = _mm_loadu_si128((const __m128i*)(rows[3] + i));
+		__m128i outer = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r3, zero));
+		__m128i inner = _mm_add_epi16(_mm_unpacklo_epi8(r1, zero), _mm_unpacklo_epi8(r2, zero));
+		__m128i lo = _mm_add_epi16(outer, _mm_add_epi16(inner, _mm_slli_epi16(inner, 1)));
+		outer = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r3, zero));
+		inner = _mm_add_epi16(_mm_unpackhi_epi8(r1, zero), _mm_unpackhi_epi8(r2, zero));
+		__m128i hi = _mm_add_epi16(outer, _mm_add_epi16(inner, _mm_slli_epi16(inner, 1)));
+		_mm_storeu_si128((__m128i*)(tmp + i), lo);
+		_mm_storeu_si128((__m128i*)(tmp + i + 8), hi);
+	}
+#endif
+	for (; i < count; i++)
+		tmp[i] = (uint16_t)(rows[0][i] + 3 * (rows[1][i] + rows[2][i]) + rows[3][i]);
+
+	int x = 0;
+#ifdef IMAGE_RESIZER_SSE2
+	if (channels == 4 && dstWidth > 0)
+	{
+		// first pixel is clamped at left edge. each iteration weights 6 neighbouring source pixels into 2 output
+		// pixels, lower half of each register is weighted 1 3 and upper half 3 1 with following register
+		DownsamplePixelBilinear(tmp, srcWidth, dst, 0, channels);
+		const __m128i weightA = _mm_set_epi16(3, 3, 3, 3, 1, 1, 1, 1);
+		const __m128i weightB = _mm_set_epi16(1, 1, 1, 1, 3, 3, 3, 3);
+		const __m128i round = _mm_set1_epi16(32);
+		for (x = 1; x + 2 <= dstWidth && 2 * x + 4 < srcWidth; x += 2)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(tmp + (2 * x - 1) * 4));
+			__m128i b = _mm_loadu_si128((const __m128i*)(tmp + (2 * x + 1) * 4));
+			__m128i c = _mm_loadu_si128((const __m128i*)(tmp + (2 * x + 3) * 4));
+			__m128i t0 = _mm_add_epi16(_mm_mullo_epi16(a, weightA), _mm_mullo_epi16(b, weightB));
+			__m128i t1 = _mm_add_epi16(_mm_mullo_epi16(b, weightA), _mm_mullo_epi16(c, weightB));
+			t0 = _mm_add_epi16(t0, _mm_srli_si128(t0, 8));
+			t1 = _mm_add_epi16(t1, _mm_srli_si128(t1, 8));
+			__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(t0, t1), round), 6);
+			_mm_storel_epi64((__m128i*)(dst + x * 4), _mm_packus_epi16(sum, sum));
+		}
+	}
+#endif
+	for (; x < dstWidth; x++)
+		DownsamplePixelBilinear(tmp, srcWidth, dst, x, channels);
+}
+
+static void GenerateMipRows(InternalState* ctx, const MediaDecoderPlaneInfo* src, int srcRowsReady, int level)
+{
+	const MediaDecoderPlaneInfo* dst = &ctx->mipLevels[level];
+	int y = ctx->mipRowsDone[level];
+	for (; y < (int)dst->height; y++)
+	{
+		// only produce rows whose source rows were already converted
+		int lastSrcRow = 2 * y + (ctx->mipFilter == MIP_FILTER_BILINEAR ? 2 : 1);
+		if (lastSrcRow >= (int)src->height)
+			lastSrcRow = src->height - 1;
+		if (lastSrcRow >= srcRowsReady)
+			break;
+
+		uint8_t* out = dst->data + (size_t)y * dst->stride;
+		if (ctx->mipFilter == MIP_FILTER_BILINEAR)
+		{
+			const uint8_t* rows[] = {
+				GetMipRow(src, 2 * y - 1), GetMipRow(src, 2 * y), GetMipRow(src, 2 * y + 1), GetMipRow(src, 2 * y + 2)
+			};
+			DownsampleRowBilinear(rows, src->width, out, dst->width, ctx->mipChannels, ctx->mipRow);
+		}
+		else
+		{
+			DownsampleRowBox(
+				GetMipRow(src, 2 * y), GetMipRow(src, 2 * y + 1), src->width, out, dst->width, ctx->mipChannels
+			);
+		}
+	}
+	ctx->mipRowsDone[level] = y;
+}
+
+static void GenerateMips(InternalState* ctx, const MediaDecoderPlaneInfo* base, int baseRowsReady)
+{
+	const MediaDecoderPlaneInfo* src = base;
+	int srcRowsReady = baseRowsReady;
+	for (int i = 0; i < ctx->mipLevelCount; i++)
+	{
+		GenerateMipRows(ctx, src, srcRowsReady, i);
+		src = &ctx->mipLevels[i];
+		srcRowsReady = ctx->mipRowsDone[i];
+	}
+}
+
+static int ResizeWithMips(
+	InternalState* ctx, const uint8_t* const* inImageData, const int* inImageStride, uint8_t* const* outImageData,
+	const int* outImageStride
+)
+{
+	MediaDecoderPlaneInfo base = {outImageData[0], ctx->cacheOutWidth, ctx->cacheOutHeight, outImageStride[0]};
+	memset(ctx->mipRowsDone, 0, sizeof(ctx->mipRowsDone));
+
+	// convert in bands and downsample each band right away, so full resolution image is only read once
+	int outRows = 0;
+	for (int y = 0; y < ctx->cacheInHeight; y += MIP_BAND_HEIGHT)
+	{
+		int h = ctx->cacheInHeight - y < MIP_BAND_HEIGHT ? ctx->cacheInHeight - y : MIP_BAND_HEIGHT;
+		if (ctx->isPassthrough)
+		{
+			av_image_copy_plane(
+				outImageData[0] + (size_t)y * outImageStride[0], outImageStride[0],
+				inImageData[0] + (size_t)y * inImageStride[0], inImageStride[0],
+				ctx->cacheOutWidth * ctx->mipChannels, h
+			);
+			outRows += h;
+		}
+		else
+		{
+			// swscale expects slice pointers to point at first row of the slice
+			const uint8_t* slice[4];
+			for (int i = 0; i < 4; i++)
+			{
+				int sliceY = (i == 1 || i == 2) ? y >> ctx->inChromaShift : y;
+				slice[i] = inImageData[i] ? inImageData[i] + (ptrdiff_t)sliceY * inImageStride[i] : NULL;
+			}
+			outRows += sws_scale(ctx->ctxScale, slice, inImageStride, y, h, outImageData, outImageStride);
+		}
+
+		GenerateMips(ctx, &base, outRows);
+	}
+
+	return outRows;
+}
+
 int ImageResizer_Resize(
 	ImageResizerContext* context, const uint8_t* const* inImageData, const int* inImageStride,
 	uint8_t* const* outImageData, const int* outImageStride
 )
 {
 	InternalState* ctx = (InternalState*)context;
+	if (ctx->mipLevelCount > 0)
+		return ResizeWithMips(ctx, inImageData, inImageStride, outImageData, outImageStride);
+
+	if (ctx->isPassthrough)
+	{
+		av_image_copy(
+			(uint8_t**)outImageData, outImageStride, (const uint8_t**)inImageData, inImageStride,
+			ctx->passthroughFormat, ctx->cacheInWidth, ctx->cacheInHeight
+		);
+		return ctx->cacheInHeight;
+	}
+
 	return sws_scale(ctx->ctxScale, inImageData, inImageStride, 0, ctx->cacheInHeight, outImageData, outImageStride);
 }
 
@@ -105,6 +451,7 @@ void ImageResizer_ReleaseContext(ImageResizerContext** context)
 {
 	InternalState* ctx = (InternalState*)*context;
 	sws_freeContext(ctx->ctxScale);
-	free(*context);
+	Allocator_Free(ctx->mipRow);
+	Allocator_Free(*context);
 	*context = NULL;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -12,11 +12,22 @@ extern "C"
 #endif
 	ImageResizerContext* ImageResizer_CreateContext();
 
+	/// @brief Select filter used by following ImageResizer_SetParameters calls
+	void ImageResizer_SetQuality(ImageResizerContext* context, enum MediaDecoderScaleQuality quality);
+
 	bool ImageResizer_SetParameters(
 		ImageResizerContext* context, int inWidth, int inHeight, enum MediaDecoderPixelFormat inFormat, int outWidth,
 		int outHeight, enum MediaDecoderPixelFormat outFormat
 	);
 
+	/// @brief Set chain of smaller images that will be generated by every following ImageResizer_Resize call
+	/// @param levels caller owned levels, NULL or levelCount of 0 disables generation
+	/// @return false if output format or level sizes are not supported
+	bool ImageResizer_SetMipChain(
+		ImageResizerContext* context, const MediaDecoderPlaneInfo* levels, int levelCount,
+		enum MediaDecoderMipFilter filter
+	);
+
 	int ImageResizer_Resize(
 		ImageResizerContext* context, const uint8_t* const* inImageData, const int* inImageStride,
 		uint8_t* const* outImageData, const int* outImageStride
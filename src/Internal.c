@@ -1,5 +1,9 @@
-#include "MediaDecoder.h"
+#include "Internal.h"
+#include "Allocator.h"
+#include <libavcodec/avcodec.h>
 #include <libavutil/channel_layout.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libavutil/pixfmt.h>
 #include <libavutil/samplefmt.h>
 
@@ -56,6 +60,14 @@ enum AVPixelFormat MapPixelFormat(enum MediaDecoderPixelFormat pixelFormat)
 		return AV_PIX_FMT_RGBAF16;
 	case PIXEL_FORMAT_R32G32B32A32_FLOAT:
 		return AV_PIX_FMT_RGBAF32;
+	case PIXEL_FORMAT_NV12:
+		return AV_PIX_FMT_NV12;
+	case PIXEL_FORMAT_I420:
+		return AV_PIX_FMT_YUV420P;
+	case PIXEL_FORMAT_YUV444P:
+		return AV_PIX_FMT_YUV444P;
+	case PIXEL_FORMAT_P010:
+		return AV_PIX_FMT_P010LE;
 
 	default:
 		return AV_PIX_FMT_NONE;
@@ -103,4 +115,86 @@ int GetPixelFormatSize(enum MediaDecoderPixelFormat pixelFormat)
 	default:
 		return -1;
 	}
+}
+
+int GetPreviewLevel(int originalWidth, int originalHeight, int decodedWidth, int decodedHeight)
+{
+	if (originalWidth < 1 || originalHeight < 1 || decodedWidth < 1 || decodedHeight < 1)
+		return 0;
+
+	// each level halves size of decoded frame, so output must be at most half size in both directions
+	int level = 0;
+	while (level < 3 && decodedWidth << (level + 1) <= originalWidth && decodedHeight << (level + 1) <= originalHeight)
+		level++;
+	return level;
+}
+
+AVCodecContext* CreateDecoder(const AVCodecParameters* codecParams, int threadCount, int previewLevel)
+{
+	const AVCodec* codec = avcodec_find_decoder(codecParams->codec_id);
+	if (!codec)
+		return NULL;
+
+	AVCodecContext* ctx = avcodec_alloc_context3(codec);
+	if (!ctx)
+		return NULL;
+
+	// 0 lets decoder pick number of threads
+	ctx->thread_count = threadCount;
+	ctx->get_buffer2 = &Allocator_GetBuffer2;
+
+	if (previewLevel > 0)
+	{
+		// errors these shortcuts cause are hardly visible once frame is scaled down
+		ctx->lowres = previewLevel < codec->max_lowres ? previewLevel : codec->max_lowres;
+		ctx->skip_loop_filter = AVDISCARD_NONREF;
+		ctx->flags2 |= AV_CODEC_FLAG2_FAST;
+		if (previewLevel > 1)
+			ctx->skip_idct = AVDISCARD_NONREF;
+	}
+
+	if (avcodec_parameters_to_context(ctx, codecParams) < 0 || avcodec_open2(ctx, codec, NULL) < 0)
+	{
+		avcodec_free_context(&ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+int FillPlaneInfo(
+	enum MediaDecoderPixelFormat pixelFormat, int width, int height, uint8_t* buffer, MediaDecoderPlaneInfo* planes
+)
+{
+	enum AVPixelFormat format = MapPixelFormat(pixelFormat);
+	const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+	if (!desc)
+		return -1;
+
+	int linesizes[4];
+	uint8_t* data[4];
+	if (av_image_fill_linesizes(linesizes, format, width) < 0)
+		return -1;
+	if (av_image_fill_pointers(data, format, height, buffer, linesizes) < 0)
+		return -1;
+
+	int planeCount = av_pix_fmt_count_planes(format);
+	for (int i = 0; i < 4; i++)
+	{
+		if (i >= planeCount)
+		{
+			planes[i].data = NULL;
+			planes[i].width = planes[i].height = planes[i].stride = 0;
+			continue;
+		}
+
+		// second and third plane of yuv formats are subsampled chroma planes
+		int isChroma = i == 1 || i == 2;
+		planes[i].data = data[i];
+		planes[i].width = isChroma ? AV_CEIL_RSHIFT(width, desc->log2_chroma_w) : width;
+		planes[i].height = isChroma ? AV_CEIL_RSHIFT(height, desc->log2_chroma_h) : height;
+		planes[i].stride = linesizes[i];
+	}
+
+	return planeCount;
 }
\ No newline at end of file
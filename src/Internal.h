@@ -1,3 +1,4 @@
+#pragma once
 
 #include "MediaDecoder.h"
 #include <libavformat/avformat.h>
@@ -7,4 +8,14 @@ struct AVChannelLayout FromEnumToChannelLayout(enum MediaDecoderChannelLayout ch
 
 enum AVPixelFormat MapPixelFormat(enum MediaDecoderPixelFormat pixelFormat);
 enum AVSampleFormat MapSampleFormat(enum MediaDecoderSampleFormat sampleFormat);
-int GetPixelFormatSize(enum MediaDecoderPixelFormat pixelFormat);
\ No newline at end of file
+int GetPixelFormatSize(enum MediaDecoderPixelFormat pixelFormat);
+int GetPreviewLevel(int originalWidth, int originalHeight, int decodedWidth, int decodedHeight);
+AVCodecContext* CreateDecoder(const AVCodecParameters* codecParams, int threadCount, int previewLevel);
+int FillPlaneInfo(
+	enum MediaDecoderPixelFormat pixelFormat, int width, int height, uint8_t* buffer, MediaDecoderPlaneInfo* planes
+);
+
+/// @brief MediaDecoder_Open that can be aborted through interrupt callback while file is being opened
+MediaDecoderContext* MediaDecoder_OpenInterruptible(const char* url, const AVIOInterruptCB* interrupt);
+/// @brief MediaDecoder_OpenAsync that also reads first frame of opened context
+MediaDecoderOpenRequest* MediaDecoder_PrerollAsync(const char* url);
@@ -1,16 +1,44 @@
 #include "MediaDecoder.h"
 
+#include "Allocator.h"
+#include "FrameCache.h"
+#include "Governor.h"
+#include "ImageCache.h"
 #include "ImageResizer.h"
 #include "Internal.h"
+#include "SequenceDecoder.h"
 #include "SoundResampler.h"
+#include "TaskQueue.h"
+#include "TensorConverter.h"
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/channel_layout.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/time.h>
+#include <math.h>
 #include <memory.h>
+#include <string.h>
 
 #define DISABLE_HARDWARE_ACCELERATION 1
 
+// seconds before end of media at which start of media is prepared for seamless looping
+#define PREROLL_LEAD_TIME 2.0
+// exact seeks up to this many seconds ahead continue decoding instead of seeking to previous keyframe
+#define MAX_CONTINUE_TIME 1.0
+// bytes of live input that are probed to detect format
+#define LIVE_PROBE_SIZE 32768
+// microseconds waited for live input when nothing arrived yet
+#define LIVE_POLL_INTERVAL 1000
+
+// output of MediaDecoder_AddView()
+typedef struct
+{
+	MediaDecoderVideoInfo video;
+	struct ImageResizerContext* resizer;
+	// number of views that share this rendition
+	int refCount;
+} Rendition;
+
 typedef struct
 {
 	MediaDecoderContext ctx;
@@ -26,6 +54,7 @@ typedef struct
 	int (*funcDecodeFrame)(MediaDecoderContext* ctx);
 
 	struct ImageResizerContext* resizer;
+	struct ImageResizerContext* tensorResizer;
 	struct SoundResamplerContext* resampler;
 
 	// playback info
@@ -34,6 +63,86 @@ typedef struct
 	double lastTime;
 	int loopCount;
 	int isImage;
+
+	// context that already read first frame of media, used for seamless looping
+	MediaDecoderOpenRequest* preroll;
+	int didLoop;
+
+	// context that already read first frame of media queued with MediaDecoder_QueueNext()
+	MediaDecoderOpenRequest* next;
+	// url of queued media, kept so that it can be queued again by MediaDecoder_Resume()
+	char* nextUrl;
+	int didSwitch;
+
+	// decoded frames kept for exact seeking and stepping, see MediaDecoder_SetFrameCache()
+	FrameCacheContext* frameCache;
+	MediaDecoderFrameCacheMode frameCacheMode;
+	uint32_t frameCacheWidth;
+	uint32_t frameCacheHeight;
+	MediaDecoderPixelFormat frameCacheFormat;
+	// pts of frame returned by MediaDecoder_SeekFrame() or MediaDecoder_StepFrame()
+	int64_t exactPts;
+	// video decoder is right after frame at lastDecodedPts, following frames can be decoded without seeking
+	int64_t lastDecodedPts;
+	int canContinueDecoding;
+
+	// current level of decoding shortcuts of video decoder, see GetPreviewLevel()
+	int previewLevel;
+	// while video decoder is replaced, previous one still decodes leading pictures of an open GOP, which refer to
+	// frames before keyframe. see MediaDecoder_UpdatePreview()
+	AVCodecContext* codecPrevious;
+	int previousLowres;
+	int64_t switchPts;
+	// keyframe and first packet after leading pictures, new decoder gets them once previous decoder is done
+	AVPacket* switchPackets[2];
+	uint32_t switchPacketCount;
+	// frames of previous decoder, they are returned before frames of new decoder
+	AVFrame** switchFrames;
+	uint32_t switchFrameCount;
+	uint32_t switchFrameCapacity;
+	// ctx->frame was decoded by previous decoder
+	int isSwitchFrame;
+
+	// quality is lowered while decoding can not keep up, see MediaDecoder_SetGovernor()
+	MediaDecoderGovernor* governor;
+	MediaDecoderGovernorLevel governorLevel;
+	// microseconds spent on converting last video frame
+	int64_t convertTime;
+	uint64_t governorFrameIndex;
+
+	// additional outputs of each converted video frame, sorted from largest to smallest
+	Rendition** renditions;
+	uint32_t renditionCount;
+
+	// newest frame is always returned for live input, see MediaDecoder_OpenLive()
+	int isLive;
+	AVFrame* liveFrame;
+	// audio packet read after a video frame, it is decoded by next call
+	AVPacket* livePacket;
+	int hasLivePacket;
+
+	// frames of image sequences are decoded ahead on worker threads, see MediaDecoder_NextFrame_Sequence()
+	SequenceDecoder* sequence;
+	// MediaDecoder_DecodeTensor() converts frames itself, so workers must leave them as decoded
+	int isDecodingTensor;
+
+	// demuxer, decoders and converters are released while suspended, see MediaDecoder_Suspend()
+	int isSuspended;
+	// pts of video frame that was read last, it is decoded again when context is resumed
+	int64_t shownPts;
+	double suspendedPosition;
+	uint32_t suspendedWidth;
+	uint32_t suspendedHeight;
+
+	// fixed size audio blocks, see MediaDecoderAudioInfo.blockSizePerChannel
+	uint32_t audioBlockFill;
+	int audioBlockPending;
+	int audioFlushed;
+
+	char* url;
+	// set when video.frameBuffer is shared with other contexts through image cache
+	ImageCacheEntry* cachedImage;
+	int didCheckImageCache;
 } InternalContext;
 
 static enum AVPixelFormat hw_pix_fmt;
@@ -122,6 +231,307 @@ static float GetAudioSample(const AVCodecContext* codecCtx, uint8_t* buffer, int
 	return ret;
 }
 
+/// @brief Take all frames previous video decoder has ready, only frames before keyframe are kept
+static void MediaDecoder_ReceiveSwitchFrames(InternalContext* ctx)
+{
+	while (avcodec_receive_frame(ctx->codecPrevious, ctx->frame) == 0)
+	{
+		// keyframe and following frames are returned by new decoder
+		int64_t pts = ctx->frame->best_effort_timestamp;
+		if (pts != AV_NOPTS_VALUE && ctx->switchPts != AV_NOPTS_VALUE && pts >= ctx->switchPts)
+		{
+			av_frame_unref(ctx->frame);
+			continue;
+		}
+
+		if (ctx->switchFrameCount == ctx->switchFrameCapacity)
+		{
+			uint32_t capacity = ctx->switchFrameCapacity ? ctx->switchFrameCapacity * 2 : 8;
+			AVFrame** tmp = Allocator_Realloc(ctx->switchFrames, sizeof(*tmp) * capacity);
+			if (!tmp)
+			{
+				av_frame_unref(ctx->frame);
+				continue;
+			}
+			ctx->switchFrames = tmp;
+			ctx->switchFrameCapacity = capacity;
+		}
+
+		AVFrame* frame = av_frame_alloc();
+		if (!frame)
+		{
+			av_frame_unref(ctx->frame);
+			continue;
+		}
+		av_frame_move_ref(frame, ctx->frame);
+		ctx->switchFrames[ctx->switchFrameCount++] = frame;
+	}
+}
+
+/// @brief Decode video packet with previous decoder while decoder is replaced
+static void MediaDecoder_SendSwitchPacket(InternalContext* ctx)
+{
+	AVPacket* packet = ctx->packet;
+	int isKeyframe = ctx->switchPacketCount == 0;
+	int isLeading = isKeyframe || (packet->pts != AV_NOPTS_VALUE && packet->pts < ctx->switchPts);
+
+	// without timestamps leading pictures can not be told apart, previous decoder only returns what it holds
+	if (ctx->switchPts == AV_NOPTS_VALUE)
+		isLeading = 0;
+
+	// all frames are taken right away, otherwise decoder would not accept more packets
+	avcodec_send_packet(ctx->codecPrevious, isLeading ? packet : NULL);
+	MediaDecoder_ReceiveSwitchFrames(ctx);
+	if (isLeading && !isKeyframe)
+	{
+		av_packet_unref(packet);
+		return;
+	}
+
+	if (!ctx->switchPackets[ctx->switchPacketCount])
+		ctx->switchPackets[ctx->switchPacketCount] = av_packet_alloc();
+	if (ctx->switchPackets[ctx->switchPacketCount])
+		av_packet_move_ref(ctx->switchPackets[ctx->switchPacketCount++], packet);
+	else
+		av_packet_unref(packet);
+
+	if (!isLeading)
+		avcodec_free_context(&ctx->codecPrevious);
+}
+
+static void MediaDecoder_CancelSwitch(InternalContext* ctx)
+{
+	avcodec_free_context(&ctx->codecPrevious);
+	for (uint32_t i = 0; i < ctx->switchFrameCount; i++)
+		av_frame_free(&ctx->switchFrames[i]);
+	ctx->switchFrameCount = 0;
+	for (uint32_t i = 0; i < ctx->switchPacketCount; i++)
+		av_packet_unref(ctx->switchPackets[i]);
+	ctx->switchPacketCount = 0;
+}
+
+/// @brief Read next packet. while video decoder is replaced, frames and packets it held back come first
+/// @return 0 if packet was read into ctx->packet, 1 if frame of previous decoder was moved into ctx->frame
+static int MediaDecoder_ReadPacket(InternalContext* ctx)
+{
+	ctx->isSwitchFrame = 0;
+	if (ctx->switchFrameCount > 0)
+	{
+		AVFrame* frame = ctx->switchFrames[0];
+		ctx->switchFrameCount--;
+		memmove(ctx->switchFrames, ctx->switchFrames + 1, sizeof(*ctx->switchFrames) * ctx->switchFrameCount);
+		av_frame_unref(ctx->frame);
+		av_frame_move_ref(ctx->frame, frame);
+		av_frame_free(&frame);
+		ctx->isSwitchFrame = 1;
+		return 1;
+	}
+
+	if (!ctx->codecPrevious && ctx->switchPacketCount > 0)
+	{
+		AVPacket* packet = ctx->switchPackets[0];
+		av_packet_move_ref(ctx->packet, packet);
+		ctx->switchPackets[0] = ctx->switchPackets[1];
+		ctx->switchPackets[1] = packet;
+		ctx->switchPacketCount--;
+		return 0;
+	}
+
+	int ret = av_read_frame(ctx->format, ctx->packet);
+	if (ret < 0 && ctx->codecPrevious)
+	{
+		// end of input, previous decoder only returns what it still holds
+		avcodec_send_packet(ctx->codecPrevious, NULL);
+		MediaDecoder_ReceiveSwitchFrames(ctx);
+		avcodec_free_context(&ctx->codecPrevious);
+		return MediaDecoder_ReadPacket(ctx);
+	}
+	return ret;
+}
+
+static void MediaDecoder_UpdatePreview(InternalContext* ctx)
+{
+	MediaDecoderVideoInfo* video = &ctx->ctx.video;
+	const AVCodecParameters* codecParams = ctx->format->streams[ctx->ctx.playback.selectedVideoStream]->codecpar;
+
+	// replacing decoder would lose low delay settings of live input and delay next frame
+	if (ctx->isLive || ctx->codecPrevious || ctx->switchPacketCount > 0)
+		return;
+
+	int level = 0;
+	if (video->previewMode == PREVIEW_MODE_AUTO)
+		level = GetPreviewLevel(codecParams->width, codecParams->height, video->decodedWidth, video->decodedHeight);
+	if (level == ctx->previewLevel)
+		return;
+
+	// lowres can only be set when decoder is opened, so decoder is replaced at keyframe. new decoder uses as many
+	// threads as the one it replaces
+	AVCodecContext* codec = CreateDecoder(codecParams, ctx->codecVideo->thread_count, level);
+	if (!codec)
+		return;
+
+	// previous decoder is kept until it returned frames it still holds, and decoded leading pictures after
+	// keyframe that refer to frames before it. new decoder starts at keyframe once previous one is done
+	ctx->codecPrevious = ctx->codecVideo;
+	ctx->previousLowres = ctx->codecVideo->lowres;
+	ctx->switchPts = ctx->packet->pts;
+	ctx->codecVideo = codec;
+	ctx->previewLevel = level;
+}
+
+static int64_t MediaDecoder_GetFrameDuration(InternalContext* ctx, const AVFrame* frame)
+{
+	if (frame->duration > 0)
+		return frame->duration;
+
+	// estimate from frame rate
+	const AVStream* stream = ctx->format->streams[ctx->ctx.playback.selectedVideoStream];
+	AVRational rate = stream->avg_frame_rate.num > 0 ? stream->avg_frame_rate : stream->r_frame_rate;
+	if (rate.num <= 0 || rate.den <= 0)
+		return 1;
+
+	int64_t duration = av_rescale_q(1, av_inv_q(rate), stream->time_base);
+	return duration > 0 ? duration : 1;
+}
+
+/// @brief Report cost of video frame that was just decoded
+/// @param decodeTime microseconds spent in video decoder for frame
+/// @return 1 if frame should be dropped
+static int MediaDecoder_ReportGovernor(InternalContext* ctx, int64_t decodeTime)
+{
+	// cost of frame is its decoding plus conversion of frame before it, which is not known any earlier
+	double cost = (decodeTime + ctx->convertTime) / 1000000.0;
+	ctx->convertTime = 0;
+
+	const AVStream* stream = ctx->format->streams[ctx->ctx.playback.selectedVideoStream];
+	double interval = MediaDecoder_GetFrameDuration(ctx, ctx->frame) * av_q2d(stream->time_base);
+	ctx->governorLevel = Governor_Report(ctx->governor, cost, interval);
+
+	return ctx->governorLevel >= GOVERNOR_LEVEL_HALF_RATE && (ctx->governorFrameIndex++ & 1);
+}
+
+static void MediaDecoder_CloseTask(void* arg)
+{
+	MediaDecoderContext* context = (MediaDecoderContext*)arg;
+	MediaDecoder_Close(&context);
+}
+
+static void MediaDecoder_StartPreroll(InternalContext* ctx)
+{
+	MediaDecoderPlaybackInfo* playback = &ctx->ctx.playback;
+	if (!playback->seamlessLoop || ctx->isImage || ctx->preroll || !ctx->url)
+		return;
+
+	// duration is not always known before first loop, in which case start is prepared right away
+	if (playback->duration > PREROLL_LEAD_TIME && playback->position < playback->duration - PREROLL_LEAD_TIME)
+		return;
+
+	ctx->preroll = MediaDecoder_PrerollAsync(ctx->url);
+}
+
+static void MediaDecoder_SwapSource(InternalContext* ctx, InternalContext* next)
+{
+	// take demuxer, decoders and already read first frame from preroll context. output settings, buffers,
+	// resizer and resampler stay, so that audio continues without gap
+	MediaDecoder_CancelSwitch(ctx);
+	AVFormatContext* format = ctx->format;
+	AVCodecContext* codecVideo = ctx->codecVideo;
+	AVCodecContext* codecAudio = ctx->codecAudio;
+	AVPacket* packet = ctx->packet;
+	AVFrame* frame = ctx->frame;
+	int previewLevel = ctx->previewLevel;
+	char* url = ctx->url;
+	SequenceDecoder* sequence = ctx->sequence;
+	ctx->format = next->format;
+	ctx->codecVideo = next->codecVideo;
+	ctx->codecAudio = next->codecAudio;
+	ctx->packet = next->packet;
+	ctx->frame = next->frame;
+	ctx->previewLevel = next->previewLevel;
+	ctx->url = next->url;
+	ctx->sequence = next->sequence;
+	ctx->funcDecodeFrame = next->funcDecodeFrame;
+	next->format = format;
+	next->codecVideo = codecVideo;
+	next->codecAudio = codecAudio;
+	next->packet = packet;
+	next->frame = frame;
+	next->previewLevel = previewLevel;
+	next->url = url;
+	next->sequence = sequence;
+#ifndef DISABLE_HARDWARE_ACCELERATION
+	AVFrame* frame2 = ctx->frame2;
+	ctx->frame2 = next->frame2;
+	next->frame2 = frame2;
+#endif
+
+	// stream layout may differ between files
+	MediaDecoderPlaybackInfo* playback = &ctx->ctx.playback;
+	playback->streamCount = next->ctx.playback.streamCount;
+	for (int i = 0; i < sizeof(playback->selectedStreams) / sizeof(*playback->selectedStreams); i++)
+		playback->selectedStreams[i] = next->ctx.playback.selectedStreams[i];
+	playback->position = 0.0;
+
+	// closing finished demuxer and decoders is left to worker
+	MediaDecoderContext* finished = (MediaDecoderContext*)next;
+	if (TaskQueue_Push(&MediaDecoder_CloseTask, finished))
+		MediaDecoder_Close(&finished);
+}
+
+static int MediaDecoder_LoopSeamless(InternalContext* ctx)
+{
+	int64_t startTime = av_gettime_relative();
+
+	MediaDecoder_StartPreroll(ctx);
+	InternalContext* next = (InternalContext*)MediaDecoder_WaitOpen(&ctx->preroll);
+	if (!next)
+		return -1;
+
+	// end was reached, so duration is known now
+	MediaDecoderPlaybackInfo* playback = &ctx->ctx.playback;
+	if (playback->position > 0.0)
+		playback->duration = playback->position;
+
+	MediaDecoder_SwapSource(ctx, next);
+
+	playback->loopLatency = (av_gettime_relative() - startTime) / 1000000.0;
+	ctx->didLoop = 1;
+	return 0;
+}
+
+static int MediaDecoder_ContinueWithNext(InternalContext* ctx)
+{
+	InternalContext* next = (InternalContext*)MediaDecoder_WaitOpen(&ctx->next);
+	Allocator_Free(ctx->nextUrl);
+	ctx->nextUrl = NULL;
+	if (!next)
+		return -1;
+
+	// start of current media, prepared for looping, is not needed anymore
+	if (ctx->preroll)
+		MediaDecoder_CancelOpen(&ctx->preroll);
+
+	ctx->ctx.playback.duration = next->ctx.playback.duration;
+	ctx->isImage = next->isImage;
+	MediaDecoder_SwapSource(ctx, next);
+
+	// resampler was flushed at end of previous media, samples of next media start right after its samples
+	if (ctx->resampler)
+		SoundResampler_Reset(ctx->resampler);
+	ctx->audioBlockPending = 0;
+	ctx->audioFlushed = 0;
+
+	// cached frames belong to previous media
+	if (ctx->frameCache)
+		FrameCache_Clear(ctx->frameCache);
+	ctx->exactPts = AV_NOPTS_VALUE;
+	ctx->canContinueDecoding = 0;
+
+	ctx->ctx.playback.itemIndex++;
+	ctx->didSwitch = 1;
+	return 0;
+}
+
 static int MediaDecoder_NextFrame_Common(InternalContext* ctx, uint32_t streamIndex)
 {
 	if (streamIndex != -1)
@@ -135,6 +545,91 @@ static int MediaDecoder_NextFrame_Common(InternalContext* ctx, uint32_t streamIn
 	return 0;
 }
 
+/// @brief Size of converted image, governor only lowers it while requested size stays. caller owned mip chain only
+/// fits requested size
+static void MediaDecoder_GetConvertedSize(InternalContext* ctx, uint32_t* width, uint32_t* height)
+{
+	*width = ctx->ctx.video.decodedWidth;
+	*height = ctx->ctx.video.decodedHeight;
+	if (ctx->governorLevel >= GOVERNOR_LEVEL_HALF_SIZE && ctx->ctx.video.mipLevelCount == 0)
+	{
+		*width = *width > 1 ? *width / 2 : 1;
+		*height = *height > 1 ? *height / 2 : 1;
+	}
+}
+
+static void MediaDecoder_SetSharedImage(InternalContext* ctx, ImageCacheEntry* entry)
+{
+	MediaDecoderVideoInfo* video = &ctx->ctx.video;
+	if (ctx->cachedImage)
+		ImageCache_Release(&ctx->cachedImage);
+	else if (video->frameBuffer != ImageCache_GetData(entry))
+		Allocator_Free(video->frameBuffer);
+
+	ctx->cachedImage = entry;
+	video->frameBuffer = ImageCache_GetData(entry);
+	video->bytesPerFrame = ImageCache_GetSize(entry);
+	// entry may have been converted at half size by a governed context
+	video->planeCount = FillPlaneInfo(
+		video->decodedPixelFormat, ImageCache_GetWidth(entry), ImageCache_GetHeight(entry), video->frameBuffer,
+		video->planes
+	);
+}
+
+static void MediaDecoder_ShareImage(InternalContext* ctx)
+{
+	// hand converted image over to image cache, so that other contexts can reuse it
+	MediaDecoderVideoInfo* video = &ctx->ctx.video;
+	ImageCacheEntry* entry = ImageCache_Insert(
+		ctx->url, video->planes[0].width, video->planes[0].height, video->decodedPixelFormat, video->frameBuffer,
+		video->bytesPerFrame
+	);
+	if (!entry)
+		return;
+
+	// buffer is now owned by cache
+	if (ImageCache_GetData(entry) == video->frameBuffer)
+	{
+		ctx->cachedImage = entry;
+		return;
+	}
+
+	// another context cached same image first and our buffer was released by cache
+	video->frameBuffer = NULL;
+	MediaDecoder_SetSharedImage(ctx, entry);
+}
+
+static int MediaDecoder_DecodeFrame_Done(MediaDecoderContext* context)
+{
+	// frame was already converted while it was read
+	return 0;
+}
+
+static int MediaDecoder_NextFrame_CachedImage(InternalContext* ctx, uint32_t* streamIndex)
+{
+	MediaDecoderVideoInfo* video = &ctx->ctx.video;
+	if (video->decodedWidth < 1 || video->decodedHeight < 1)
+		return -1;
+
+	ctx->didCheckImageCache = 1;
+	uint32_t width, height;
+	MediaDecoder_GetConvertedSize(ctx, &width, &height);
+	ImageCacheEntry* entry = ImageCache_Acquire(ctx->url, width, height, video->decodedPixelFormat);
+	if (!entry)
+		return -1;
+
+	MediaDecoder_SetSharedImage(ctx, entry);
+
+	if (streamIndex)
+		*streamIndex = ctx->ctx.playback.selectedVideoStream;
+	ctx->ctx.playback.position = 0.0;
+	ctx->funcDecodeFrame = &MediaDecoder_DecodeFrame_Done;
+
+	// image only has a single frame, so there is nothing more to read
+	ctx->isImage = 2;
+	return 0;
+}
+
 static int MediaDecoder_NextFrame_Video(MediaDecoderContext* context)
 {
 	InternalContext* ctx = (InternalContext*)context;
@@ -145,51 +640,178 @@ static int MediaDecoder_NextFrame_Video(MediaDecoderContext* context)
 	if (context->video.decodedHeight < 1)
 		context->video.decodedHeight = frame->height;
 
+	uint32_t width, height;
+	MediaDecoder_GetConvertedSize(ctx, &width, &height);
+
 	// we tell ImageResizer_SetParameters() that pixFmt is actually AVPixelFormat by or'ing 0x10000.
 	enum MediaDecoderPixelFormat pixFmt = frame->format | 0x10000;
 
 	// convert to size and format that we want
+	MediaDecoderScaleQuality scaleQuality = context->video.scaleQuality;
+	if (ctx->governorLevel >= GOVERNOR_LEVEL_FAST_SCALING)
+		scaleQuality = SCALE_QUALITY_FAST_BILINEAR;
+	ImageResizer_SetQuality(ctx->resizer, scaleQuality);
 	ImageResizer_SetParameters(
-		ctx->resizer, frame->width, frame->height, pixFmt, context->video.decodedWidth, context->video.decodedHeight,
-		context->video.decodedPixelFormat
+		ctx->resizer, frame->width, frame->height, pixFmt, width, height, context->video.decodedPixelFormat
 	);
 
-	if (!context->video.frameBuffer)
+	if (!ImageResizer_SetMipChain(
+			ctx->resizer, context->video.mipLevels, context->video.mipLevelCount, context->video.mipFilter
+		))
 	{
-		context->video.bytesPerFrame = av_image_get_buffer_size(
-			MapPixelFormat(ctx->ctx.video.decodedPixelFormat), context->video.decodedWidth,
-			context->video.decodedHeight, 1
-		);
+		return -1;
+	}
 
-		if (context->video.bytesPerFrame < 1)
-			return -1;
+	if (ctx->cachedImage)
+	{
+		// shared buffer is read only, convert into a buffer owned by this context
+		ImageCache_Release(&ctx->cachedImage);
+		context->video.frameBuffer = NULL;
+		context->video.bytesPerFrame = 0;
+	}
 
-		// create frame buffer if it doesnt already exist
-		context->video.frameBuffer = malloc(context->video.bytesPerFrame);
-		if (!context->video.frameBuffer)
+	int bytesPerFrame =
+		av_image_get_buffer_size(MapPixelFormat(ctx->ctx.video.decodedPixelFormat), width, height, 1);
+	if (bytesPerFrame < 1)
+		return -1;
+
+	if (!context->video.frameBuffer || (uint32_t)bytesPerFrame != context->video.bytesPerFrame)
+	{
+		// create frame buffer if it doesnt already exist or if output size or format changed
+		void* tmp = Allocator_Realloc(context->video.frameBuffer, bytesPerFrame);
+		if (!tmp)
 			return -1;
+		context->video.frameBuffer = tmp;
+		context->video.bytesPerFrame = bytesPerFrame;
 	}
 
-	uint8_t* outImageData[] = {context->video.frameBuffer, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
-	// int linesize = av_image_get_linesize(context->video.decodedPixelFormat, context->video.decodedWidth, 1);
-	int outImageLineSize[] = {0, 0, 0, 0, 0, 0, 0, 0};
-
-	outImageLineSize[0] = GetPixelFormatSize(context->video.decodedPixelFormat);
-	if (outImageLineSize[0] == -1)
+	int planeCount = FillPlaneInfo(
+		context->video.decodedPixelFormat, width, height, context->video.frameBuffer, context->video.planes
+	);
+	if (planeCount < 1)
 		return -1;
+	context->video.planeCount = planeCount;
+
+	uint8_t* outImageData[] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+	int outImageLineSize[] = {0, 0, 0, 0, 0, 0, 0, 0};
+	for (int i = 0; i < planeCount; i++)
+	{
+		outImageData[i] = context->video.planes[i].data;
+		outImageLineSize[i] = context->video.planes[i].stride;
+	}
 
-	outImageLineSize[0] *= context->video.decodedWidth;
 	ImageResizer_Resize(ctx->resizer, (const uint8_t**)frame->data, frame->linesize, outImageData, outImageLineSize);
 
+	if (ctx->isImage)
+		MediaDecoder_ShareImage(ctx);
+
 	MediaDecoder_NextFrame_Common(ctx, context->playback.selectedVideoStream);
 
 	return 0;
 }
 
-static int MediaDecoder_NextFrame_Audio(MediaDecoderContext* context)
+/// @brief Find smallest image already converted for current frame that rendition at index can be scaled down from
+static const MediaDecoderVideoInfo* MediaDecoder_FindRenditionSource(InternalContext* ctx, uint32_t index)
 {
-	InternalContext* ctx = (InternalContext*)context;
-	AVFrame* frame = ctx->frame;
+	const MediaDecoderVideoInfo* target = &ctx->renditions[index]->video;
+	const MediaDecoderVideoInfo* source = NULL;
+
+	// renditions before index are larger ones that were converted already
+	for (uint32_t i = 0; i <= index; i++)
+	{
+		const MediaDecoderVideoInfo* video = i < index ? &ctx->renditions[i]->video : &ctx->ctx.video;
+		// scaling from image of less than twice the size saves little and loses sharpness. size of converted image is
+		// in planes, main output may be converted at less than requested size
+		if (video->decodedPixelFormat != target->decodedPixelFormat || !video->frameBuffer ||
+			video->planes[0].width < target->decodedWidth * 2 || video->planes[0].height < target->decodedHeight * 2)
+		{
+			continue;
+		}
+		if (!source || (uint64_t)video->planes[0].width * video->planes[0].height <
+						   (uint64_t)source->planes[0].width * source->planes[0].height)
+		{
+			source = video;
+		}
+	}
+	return source;
+}
+
+static int MediaDecoder_ConvertRenditions(InternalContext* ctx)
+{
+	const AVFrame* frame = ctx->frame;
+	MediaDecoderScaleQuality scaleQuality = ctx->ctx.video.scaleQuality;
+	if (ctx->governorLevel >= GOVERNOR_LEVEL_FAST_SCALING)
+		scaleQuality = SCALE_QUALITY_FAST_BILINEAR;
+
+	for (uint32_t i = 0; i < ctx->renditionCount; i++)
+	{
+		MediaDecoderVideoInfo* video = &ctx->renditions[i]->video;
+		video->originalWidth = ctx->ctx.video.originalWidth;
+		video->originalHeight = ctx->ctx.video.originalHeight;
+
+		const uint8_t* inImageData[] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+		int inImageLineSize[] = {0, 0, 0, 0, 0, 0, 0, 0};
+		int inWidth;
+		int inHeight;
+		enum MediaDecoderPixelFormat inFormat;
+
+		const MediaDecoderVideoInfo* source = MediaDecoder_FindRenditionSource(ctx, i);
+		if (source)
+		{
+			for (uint32_t p = 0; p < source->planeCount; p++)
+			{
+				inImageData[p] = source->planes[p].data;
+				inImageLineSize[p] = source->planes[p].stride;
+			}
+			inWidth = source->planes[0].width;
+			inHeight = source->planes[0].height;
+			inFormat = source->decodedPixelFormat;
+		}
+		else
+		{
+			for (int p = 0; p < AV_NUM_DATA_POINTERS; p++)
+			{
+				inImageData[p] = frame->data[p];
+				inImageLineSize[p] = frame->linesize[p];
+			}
+			inWidth = frame->width;
+			inHeight = frame->height;
+			inFormat = frame->format | 0x10000;
+		}
+
+		ImageResizer_SetQuality(ctx->renditions[i]->resizer, scaleQuality);
+		if (!ImageResizer_SetParameters(
+				ctx->renditions[i]->resizer, inWidth, inHeight, inFormat, video->decodedWidth, video->decodedHeight,
+				video->decodedPixelFormat
+			))
+		{
+			return -1;
+		}
+
+		uint8_t* outImageData[] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+		int outImageLineSize[] = {0, 0, 0, 0, 0, 0, 0, 0};
+		for (uint32_t p = 0; p < video->planeCount; p++)
+		{
+			outImageData[p] = video->planes[p].data;
+			outImageLineSize[p] = video->planes[p].stride;
+		}
+		ImageResizer_Resize(ctx->renditions[i]->resizer, inImageData, inImageLineSize, outImageData, outImageLineSize);
+	}
+
+	return 0;
+}
+
+static void MediaDecoder_FreeRendition(Rendition* rendition)
+{
+	if (rendition->resizer)
+		ImageResizer_ReleaseContext(&rendition->resizer);
+	Allocator_Free(rendition->video.frameBuffer);
+	Allocator_Free(rendition);
+}
+
+static int MediaDecoder_SetupAudio(InternalContext* ctx, const AVFrame* frame)
+{
+	MediaDecoderContext* context = &ctx->ctx;
 
 	if (context->audio.originalSampleRate <= 0)
 	{
@@ -214,19 +836,23 @@ static int MediaDecoder_NextFrame_Audio(MediaDecoderContext* context)
 		context->audio.channelCount = frame->ch_layout.nb_channels;
 	}
 
-	// resample and reformat
-	SoundResampler_SetParameters(
-		ctx->resampler, frame->sample_rate, FromChannelLayoutToEnum(frame->ch_layout),
-		(enum MediaDecoderSampleFormat)frame->format, context->audio.decodedSampleRate,
-		(uint64_t)context->audio.decodedChannelLayout, context->audio.decodedSampleFormat
-	);
+	SoundResampler_SetQuality(ctx->resampler, context->audio.resampleQuality);
 
-	// samples in read frame
-	uint32_t inSamplesPerChannel = frame->nb_samples;
+	// resample and reformat, we tell SoundResampler_SetParameters() that input format is AVSampleFormat
+	if (!SoundResampler_SetParameters(
+			ctx->resampler, frame->sample_rate, FromChannelLayoutToEnum(frame->ch_layout), frame->format | 0x10000,
+			context->audio.decodedSampleRate, context->audio.decodedChannelLayout, context->audio.decodedSampleFormat
+		))
+	{
+		return -1;
+	}
 
-	// samples in buffer after resampling
-	uint32_t outSamplesPerChannel = SoundResampler_FindMaxOutputSamples(ctx->resampler, inSamplesPerChannel);
+	return 0;
+}
 
+static int MediaDecoder_ReserveAudio(InternalContext* ctx, uint32_t samplesPerChannel)
+{
+	MediaDecoderContext* context = &ctx->ctx;
 	enum AVSampleFormat rawFormat = MapSampleFormat(context->audio.decodedSampleFormat);
 
 	if (!context->audio.frameBuffer)
@@ -243,485 +869,2109 @@ static int MediaDecoder_NextFrame_Audio(MediaDecoderContext* context)
 			}
 		}
 
-		uint32_t bytesInFrame =
-			av_samples_get_buffer_size(NULL, context->audio.channelCount, outSamplesPerChannel, rawFormat, 0);
+		int bytesInFrame =
+			av_samples_get_buffer_size(NULL, context->audio.channelCount, samplesPerChannel, rawFormat, 1);
 		if (bytesInFrame < 0)
 			return -1;
 
-		context->audio.frameBuffer = malloc(bytesInFrame);
+		context->audio.frameBuffer = Allocator_Alloc(bytesInFrame);
 		if (!context->audio.frameBuffer)
 			return -1;
-		context->audio.sampleCapacityPerChannel = outSamplesPerChannel;
+		context->audio.sampleCapacityPerChannel = samplesPerChannel;
 	}
-	else if (outSamplesPerChannel > context->audio.sampleCapacityPerChannel)
+	else if (samplesPerChannel > context->audio.sampleCapacityPerChannel)
 	{
 		// make buffer larger if needed
-		uint32_t bytesInFrame =
-			av_samples_get_buffer_size(NULL, context->audio.channelCount, outSamplesPerChannel, rawFormat, 0);
+		int bytesInFrame =
+			av_samples_get_buffer_size(NULL, context->audio.channelCount, samplesPerChannel, rawFormat, 1);
 		if (bytesInFrame < 0)
 			return -1;
-		void* tmp = realloc(context->audio.frameBuffer, bytesInFrame);
-		context->audio.sampleCapacityPerChannel = outSamplesPerChannel;
+		void* tmp = Allocator_Realloc(context->audio.frameBuffer, bytesInFrame);
 		if (!tmp)
 			return -1;
 		context->audio.frameBuffer = tmp;
+		context->audio.sampleCapacityPerChannel = samplesPerChannel;
 	}
-	context->audio.sampleCountPerChannel = SoundResampler_Resample(
-		ctx->resampler, (const uint8_t**)frame->extended_data, inSamplesPerChannel, &context->audio.frameBuffer,
-		outSamplesPerChannel
-	);
-
-	MediaDecoder_NextFrame_Common(ctx, context->playback.selectedAudioStream);
 
 	return 0;
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void MediaDecoder_UpdateAudioDelay(InternalContext* ctx)
+{
+	MediaDecoderAudioInfo* audio = &ctx->ctx.audio;
+	if (audio->decodedSampleRate <= 0)
+		return;
+
+	// samples that are still inside resampler and samples of block that was not yet delivered
+	int64_t delay = SoundResampler_GetDelay(ctx->resampler);
+	if (audio->blockSizePerChannel && ctx->audioBlockFill < audio->blockSizePerChannel)
+		delay += ctx->audioBlockFill;
+	audio->delay = (double)delay / audio->decodedSampleRate;
+}
 
-MediaDecoderContext* MediaDecoder_Open(const char* url)
+/// @brief Write resampled samples of frame (or samples that resampler still holds, if frame is NULL) into
+/// block that is being filled
+/// @return 1 if block is complete, 0 if more samples are needed
+static int MediaDecoder_FillAudioBlock(InternalContext* ctx, const AVFrame* frame)
 {
-	InternalContext* ctx = malloc(sizeof(*ctx));
-	if (!ctx)
-		return NULL;
+	MediaDecoderAudioInfo* audio = &ctx->ctx.audio;
+	uint32_t blockSize = audio->blockSizePerChannel;
 
-	// open container file and loop through each stream
-	ctx->format = avformat_alloc_context();
-	int ret;
-	ret = avformat_open_input(&ctx->format, url, NULL /*autodetect fileformat*/, NULL /*no options*/);
-	if (ret < 0)
-		return NULL;
+	if (frame && MediaDecoder_SetupAudio(ctx, frame))
+		return -1;
+	if (MediaDecoder_ReserveAudio(ctx, blockSize))
+		return -1;
 
-	// allocate packet and frame, so we can use them when decoding
-	ctx->packet = av_packet_alloc();
-	ctx->frame = av_frame_alloc();
-#ifndef DISABLE_HARDWARE_ACCELERATION
-	ctx->frame2 = av_frame_alloc();
-#endif
+	// previous block was already delivered
+	if (ctx->audioBlockFill >= blockSize)
+		ctx->audioBlockFill = 0;
 
-	// set default values for context
-	MediaDecoderPlaybackInfo* playback = &ctx->ctx.playback;
-	playback->streamCount = ctx->format->nb_streams;
-	playback->selectedVideoStream = playback->selectedAudioStream = playback->selectedSubtitleStream = -1;
+	// write straight after samples that are already in block, resampler buffers whatever doesn't fit
+	uint8_t* out = audio->frameBuffer + (size_t)ctx->audioBlockFill * audio->channelCount * audio->bytesPerSample;
+	int written;
+	if (frame)
+	{
+		written = SoundResampler_Resample(
+			ctx->resampler, (const uint8_t**)frame->extended_data, frame->nb_samples, &out,
+			blockSize - ctx->audioBlockFill
+		);
+	}
+	else
+	{
+		written = SoundResampler_Drain(ctx->resampler, &out, blockSize - ctx->audioBlockFill);
+	}
 
-	ctx->codecVideo = NULL;
-	ctx->ctx.video.frameBuffer = NULL;
-	ctx->resizer = NULL;
+	if (written < 0)
+		return -1;
 
-	ctx->codecAudio = NULL;
-	ctx->ctx.audio.frameBuffer = NULL;
-	ctx->ctx.audio.sampleCountPerChannel = 0;
-	ctx->ctx.audio.channelCount = 0;
-	ctx->ctx.audio.frameBuffer = NULL;
-	ctx->isImage = 0;
-	ctx->resampler = NULL;
+	if (frame)
+		MediaDecoder_NextFrame_Common(ctx, ctx->ctx.playback.selectedAudioStream);
 
-	// TODO: use av_find_best_stream(...)
-	// av_find_best_stream(ctx->format, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, NULL);
+	ctx->audioBlockFill += written;
+	ctx->audioBlockPending = ctx->audioBlockFill >= blockSize;
+	MediaDecoder_UpdateAudioDelay(ctx);
 
-	for (unsigned int i = 0; i < ctx->format->nb_streams; i++)
-	{
-		AVStream* stream = ctx->format->streams[i];
-		if (playback->selectedVideoStream == -1 && stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
-		{
-			playback->selectedVideoStream = i;
-			ctx->ctx.video.originalWidth = ctx->ctx.video.decodedWidth = stream->codecpar->width;
-			ctx->ctx.video.originalHeight = ctx->ctx.video.decodedHeight = stream->codecpar->height;
-			ctx->ctx.video.decodedPixelFormat = PIXEL_FORMAT_R8G8B8A8_UINT;
-			if (ctx->ctx.video.decodedWidth > 0 && ctx->ctx.video.decodedHeight > 0)
-			{
-				ctx->ctx.video.bytesPerFrame = av_image_get_buffer_size(
-					MapPixelFormat(ctx->ctx.video.decodedPixelFormat), ctx->ctx.video.decodedWidth,
-					ctx->ctx.video.decodedHeight, 1
-				);
-			}
-			else
-			{
-				ctx->ctx.video.bytesPerFrame = 0;
-			}
-		}
-		else if (playback->selectedAudioStream == -1 && stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)
-		{
-			playback->selectedAudioStream = i;
-		}
-		else if (playback->selectedSubtitleStream == -1 && stream->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE)
+	if (!ctx->audioBlockPending)
+		return 0;
+
+	audio->sampleCountPerChannel = blockSize;
+	return 1;
+}
+
+static void MediaDecoder_ResetAudio(InternalContext* ctx)
+{
+	// samples from before seek must not end up in following blocks
+	if (ctx->resampler)
+		SoundResampler_Reset(ctx->resampler);
+	ctx->audioBlockFill = 0;
+	ctx->audioBlockPending = 0;
+	ctx->audioFlushed = 0;
+}
+
+/// @brief Write samples that are left in resampler at end of stream
+/// @param padLastBlock pad incomplete block with silence, otherwise it is kept to be continued by next media
+/// @return 1 if frameBuffer contains samples that need to be delivered
+static int MediaDecoder_FlushAudio(InternalContext* ctx, int padLastBlock)
+{
+	MediaDecoderAudioInfo* audio = &ctx->ctx.audio;
+	if (!ctx->resampler || ctx->audioFlushed || !audio->frameBuffer)
+		return 0;
+
+	if (!audio->blockSizePerChannel)
+	{
+		int written = SoundResampler_Flush(ctx->resampler, &audio->frameBuffer, audio->sampleCapacityPerChannel);
+		if (written < (int)audio->sampleCapacityPerChannel)
+			ctx->audioFlushed = 1;
+		if (written <= 0)
+			return 0;
+
+		audio->sampleCountPerChannel = written;
+		MediaDecoder_UpdateAudioDelay(ctx);
+		return 1;
+	}
+
+	uint32_t blockSize = audio->blockSizePerChannel;
+	if (ctx->audioBlockFill >= blockSize)
+		ctx->audioBlockFill = 0;
+
+	uint8_t* out = audio->frameBuffer + (size_t)ctx->audioBlockFill * audio->channelCount * audio->bytesPerSample;
+	int written = SoundResampler_Flush(ctx->resampler, &out, blockSize - ctx->audioBlockFill);
+	if (written > 0)
+		ctx->audioBlockFill += written;
+
+	if (ctx->audioBlockFill < blockSize)
+	{
+		// last block, pad it with silence so that it still has expected size
+		ctx->audioFlushed = 1;
+		if (ctx->audioBlockFill == 0 || !padLastBlock)
+			return 0;
+
+		av_samples_set_silence(
+			&audio->frameBuffer, ctx->audioBlockFill, blockSize - ctx->audioBlockFill, audio->channelCount,
+			MapSampleFormat(audio->decodedSampleFormat)
+		);
+		audio->sampleCountPerChannel = ctx->audioBlockFill;
+		ctx->audioBlockFill = blockSize;
+	}
+	else
+	{
+		audio->sampleCountPerChannel = blockSize;
+	}
+
+	ctx->audioBlockPending = 0;
+	MediaDecoder_UpdateAudioDelay(ctx);
+	return 1;
+}
+
+static int MediaDecoder_NextFrame_Audio(MediaDecoderContext* context)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	AVFrame* frame = ctx->frame;
+
+	if (MediaDecoder_SetupAudio(ctx, frame))
+		return -1;
+
+	// samples in read frame
+	uint32_t inSamplesPerChannel = frame->nb_samples;
+
+	// samples in buffer after resampling
+	uint32_t outSamplesPerChannel = SoundResampler_FindMaxOutputSamples(ctx->resampler, inSamplesPerChannel);
+
+	if (MediaDecoder_ReserveAudio(ctx, outSamplesPerChannel))
+		return -1;
+
+	int written = SoundResampler_Resample(
+		ctx->resampler, (const uint8_t**)frame->extended_data, inSamplesPerChannel, &context->audio.frameBuffer,
+		outSamplesPerChannel
+	);
+	if (written < 0)
+		return -1;
+	context->audio.sampleCountPerChannel = written;
+	MediaDecoder_UpdateAudioDelay(ctx);
+
+	MediaDecoder_NextFrame_Common(ctx, context->playback.selectedAudioStream);
+
+	return 0;
+}
+
+static int MediaDecoder_SetReadFrame(
+	InternalContext* ctx, AVCodecContext* codec, const AVFrame* softwareFrame, uint32_t* streamIndex
+)
+{
+	if (codec == ctx->codecVideo)
+	{
+		if (streamIndex)
+			*streamIndex = ctx->ctx.playback.selectedVideoStream;
+
+		// always update original size to support different sized frames
+		ctx->ctx.video.originalWidth = softwareFrame->width;
+		ctx->ctx.video.originalHeight = softwareFrame->height;
+		if ((ctx->isSwitchFrame ? ctx->previousLowres : ctx->codecVideo->lowres) > 0)
 		{
-			playback->selectedSubtitleStream = i;
+			// frame was decoded at reduced size
+			const AVStream* stream = ctx->format->streams[ctx->ctx.playback.selectedVideoStream];
+			ctx->ctx.video.originalWidth = stream->codecpar->width;
+			ctx->ctx.video.originalHeight = stream->codecpar->height;
 		}
+
+		ctx->shownPts = softwareFrame->best_effort_timestamp;
+		ctx->funcDecodeFrame = &MediaDecoder_NextFrame_Video;
 	}
+	else if (codec == ctx->codecAudio)
+	{
+		if (streamIndex)
+			*streamIndex = ctx->ctx.playback.selectedAudioStream;
 
-	playback->position = 0.0;
-	playback->duration = 0.0;
+		// always update original sample rate to support variable sample rate
+		ctx->ctx.audio.originalSampleRate = softwareFrame->sample_rate > 0 ? softwareFrame->sample_rate : 44100;
 
-	if (playback->selectedVideoStream != -1 && playback->selectedAudioStream == -1 &&
-		ctx->format->duration == AV_NOPTS_VALUE)
+		if (ctx->ctx.audio.blockSizePerChannel)
+			ctx->funcDecodeFrame = &MediaDecoder_DecodeFrame_Done;
+		else
+			ctx->funcDecodeFrame = &MediaDecoder_NextFrame_Audio;
+	}
+	else
 	{
-		// assume that if we can not know or estimate duration of media,
-		// then it probably only has one frame, which means that it must be an image.
-		ctx->isImage = 1;
+		// should never happen
+		return -100;
 	}
 
-	for (int i = 0; i < sizeof(playback->selectedStreams) / sizeof(*playback->selectedStreams); i++)
+	return 0;
+}
+
+static int MediaDecoder_NextFrame_Prerolled(InternalContext* ctx, uint32_t* streamIndex)
+{
+	// first frame of media was already read by preroll context. image sequence frame it converted for its own output
+	// is converted again for output of this context
+	if (ctx->sequence && ctx->funcDecodeFrame == &MediaDecoder_DecodeFrame_Done)
+		ctx->funcDecodeFrame = &MediaDecoder_NextFrame_Video;
+	AVCodecContext* codec = ctx->funcDecodeFrame == &MediaDecoder_NextFrame_Video ? ctx->codecVideo : ctx->codecAudio;
+	if (codec == ctx->codecAudio && ctx->ctx.audio.blockSizePerChannel)
 	{
-		if (playback->selectedStreams[i] == -1)
-			continue;
+		int ret = MediaDecoder_FillAudioBlock(ctx, ctx->frame);
+		if (ret < 0)
+			return -1;
+		if (ret == 0)
+			return MediaDecoder_NextFrame(&ctx->ctx, streamIndex);
+	}
 
-		AVStream* stream = ctx->format->streams[playback->selectedStreams[i]];
+	return MediaDecoder_SetReadFrame(ctx, codec, ctx->frame, streamIndex);
+}
 
-		if (stream->duration != AV_NOPTS_VALUE)
-		{
-			double d = (double)stream->duration * stream->time_base.num / stream->time_base.den;
-			if (d > playback->duration)
-				playback->duration = d / 1000.0;
+static void MediaDecoder_CheckFrameCache(InternalContext* ctx)
+{
+	// converted images are only valid for output settings they were converted with
+	MediaDecoderVideoInfo* video = &ctx->ctx.video;
+	if (ctx->frameCacheWidth != video->decodedWidth || ctx->frameCacheHeight != video->decodedHeight ||
+		ctx->frameCacheFormat != video->decodedPixelFormat)
+	{
+		if (ctx->frameCacheMode == FRAME_CACHE_CONVERTED)
+			FrameCache_Clear(ctx->frameCache);
+		ctx->frameCacheWidth = video->decodedWidth;
+		ctx->frameCacheHeight = video->decodedHeight;
+		ctx->frameCacheFormat = video->decodedPixelFormat;
+	}
+}
 
-			AVRational r = stream->avg_frame_rate;
-			if (r.den > 0)
-			{
-				int64_t frameCount = stream->duration * r.num / r.den;
-				// ctx->isImage = frameCount == 1;
-			}
-		}
-		if (ctx->format->duration != AV_NOPTS_VALUE)
-		{
-			double d = (double)ctx->format->duration * stream->time_base.num / stream->time_base.den;
-			if (d > playback->duration)
-				playback->duration = d / 1000.0;
-		}
+/// @brief Find pts of first frame that is worth converting while decoding up to pts in FRAME_CACHE_CONVERTED mode
+static int64_t MediaDecoder_GetFirstKeptPts(InternalContext* ctx, int64_t pts)
+{
+	uint32_t bytesPerFrame = ctx->ctx.video.bytesPerFrame;
+	if (ctx->frameCacheMode != FRAME_CACHE_CONVERTED || !bytesPerFrame)
+		return INT64_MIN;
+
+	// cache keeps frames closest to frame after wanted one, earlier frames would be evicted again before wanted
+	// frame is reached
+	uint64_t keepCount = FrameCache_GetBudget(ctx->frameCache) / bytesPerFrame;
+	if (keepCount < 2)
+		return pts + 1;
+
+	int64_t duration = MediaDecoder_GetFrameDuration(ctx, ctx->frame);
+	if (keepCount - 2 >= ((uint64_t)pts - (uint64_t)INT64_MIN) / (uint64_t)duration)
+		return INT64_MIN;
+	return pts - (int64_t)(keepCount - 2) * duration;
+}
 
-		if (stream->nb_frames != 0)
+static int MediaDecoder_CacheFrame(
+	InternalContext* ctx, AVFrame* frame, int64_t pts, int64_t prevPts, int64_t firstKeptPts
+)
+{
+	int64_t duration = MediaDecoder_GetFrameDuration(ctx, frame);
+	if (ctx->frameCacheMode == FRAME_CACHE_DECODED)
+	{
+		FrameCache_InsertFrame(ctx->frameCache, frame, pts, duration, prevPts);
+	}
+	else if (ctx->frameCacheMode == FRAME_CACHE_CONVERTED)
+	{
+		// frames that are already cached or would be evicted right away are not converted
+		if (FrameCache_Update(ctx->frameCache, pts, prevPts) || pts < firstKeptPts)
+			return 0;
+
+		// convert right away, so that showing frame later is only a copy
+		AVFrame* current = ctx->frame;
+		ctx->frame = frame;
+		int ret = MediaDecoder_NextFrame_Video(&ctx->ctx);
+		ctx->frame = current;
+		if (ret)
+			return -1;
+
+		MediaDecoderVideoInfo* video = &ctx->ctx.video;
+		FrameCache_InsertImage(ctx->frameCache, video->frameBuffer, video->bytesPerFrame, pts, duration, prevPts);
+	}
+	return 0;
+}
+
+static int MediaDecoder_ReadVideoPacket(InternalContext* ctx)
+{
+	while (av_read_frame(ctx->format, ctx->packet) == 0)
+	{
+		if (ctx->packet->stream_index == ctx->ctx.playback.selectedVideoStream)
 		{
-			// ctx->isImage = stream->nb_frames == 1;
+			avcodec_send_packet(ctx->codecVideo, ctx->packet);
+			av_packet_unref(ctx->packet);
+			return 0;
 		}
+		av_packet_unref(ctx->packet);
 	}
+	return -1;
+}
 
-	if (playback->selectedVideoStream != -1)
-	{
-		// prepare correct video codec, try to setup hardware accelerated decoder
-		const AVCodecParameters* codecParams = ctx->format->streams[playback->selectedVideoStream]->codecpar;
-		const AVCodec* codec = avcodec_find_decoder(codecParams->codec_id);
+/// @brief Decode frames up to frame that is shown at pts into ctx->frame, decoded frames are cached on the way
+static int MediaDecoder_DecodeUntil(InternalContext* ctx, int64_t pts)
+{
+	AVCodecContext* codec = ctx->codecVideo;
+	const AVStream* stream = ctx->format->streams[ctx->ctx.playback.selectedVideoStream];
+	int64_t maxContinue = (int64_t)(MAX_CONTINUE_TIME / av_q2d(stream->time_base));
 
-		ctx->codecVideo = avcodec_alloc_context3(codec);
-		avcodec_parameters_to_context(ctx->codecVideo, codecParams);
+	int64_t prevPts = AV_NOPTS_VALUE;
+	if (ctx->canContinueDecoding && pts > ctx->lastDecodedPts && pts - ctx->lastDecodedPts <= maxContinue)
+	{
+		prevPts = ctx->lastDecodedPts;
+	}
+	else
+	{
+		if (av_seek_frame(ctx->format, ctx->ctx.playback.selectedVideoStream, pts, AVSEEK_FLAG_BACKWARD) < 0)
+			return -1;
+		if (ctx->sequence)
+			SequenceDecoder_Cancel(ctx->sequence);
+		MediaDecoder_CancelSwitch(ctx);
+		avcodec_flush_buffers(codec);
+		if (ctx->codecAudio)
+			avcodec_flush_buffers(ctx->codecAudio);
+		MediaDecoder_ResetAudio(ctx);
+	}
+	ctx->canContinueDecoding = 0;
 
-		enum AVHWDeviceType type = AV_HWDEVICE_TYPE_NONE;
+	AVFrame* frame = av_frame_alloc();
+	if (!frame)
+		return -1;
 
-#ifndef DISABLE_HARDWARE_ACCELERATION
-		int i = 0;
-		while (i >= 0)
+	int64_t firstKeptPts = MediaDecoder_GetFirstKeptPts(ctx, pts);
+	int hasResult = 0;
+	int isDraining = 0;
+	int ret = 0;
+	while (ret == 0)
+	{
+		ret = avcodec_receive_frame(codec, frame);
+		if (ret == AVERROR(EAGAIN))
 		{
-			const AVCodecHWConfig* hwConfig = avcodec_get_hw_config(codecVideo, i);
-			if (!hwConfig)
-			{
+			ret = 0;
+			if (isDraining)
 				break;
-			}
-
-			if (hwConfig->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX)
+			if (MediaDecoder_ReadVideoPacket(ctx))
 			{
-				type = AV_HWDEVICE_TYPE_NONE;
-				while ((type = av_hwdevice_iterate_types(type)) != AV_HWDEVICE_TYPE_NONE)
-				{
-					if (hwConfig->device_type == type)
-					{
-						hw_pix_fmt = hwConfig->pix_fmt;
-						if (hw_decoder_init(ctx->codecVideo, type) < 0)
-						{
-							// couldnt initialize hardware decoder, continue searching
-							hw_pix_fmt = AV_PIX_FMT_NONE;
-							continue;
-						}
-						i = -1;
-						break;
-					}
-				}
-				if (i == -1)
-					break;
+				// get remaining frames out of decoder
+				isDraining = 1;
+				avcodec_send_packet(codec, NULL);
 			}
+			continue;
+		}
+		if (ret == AVERROR_EOF)
+		{
+			ret = 0;
+			break;
+		}
+		if (ret < 0)
+			break;
 
-			i++;
+		int64_t framePts = frame->best_effort_timestamp;
+		if (framePts == AV_NOPTS_VALUE)
+		{
+			av_frame_unref(frame);
+			continue;
 		}
-#endif
 
-		if (type == AV_HWDEVICE_TYPE_NONE)
+		if (ctx->frameCacheMode != FRAME_CACHE_OFF &&
+			MediaDecoder_CacheFrame(ctx, frame, framePts, prevPts, firstKeptPts))
 		{
-			// printf("using softwaredecoding.\n");
+			ret = -1;
+			break;
 		}
+		prevPts = framePts;
 
-		avcodec_open2(ctx->codecVideo, codec, NULL /*no options*/);
+		if (framePts > pts && hasResult)
+		{
+			// frame after wanted one, decoding can only continue from here if it was cached
+			ctx->lastDecodedPts = framePts;
+			ctx->canContinueDecoding = ctx->frameCacheMode != FRAME_CACHE_OFF;
+			break;
+		}
 
-		ctx->resizer = ImageResizer_CreateContext();
+		av_frame_unref(ctx->frame);
+		av_frame_move_ref(ctx->frame, frame);
+		hasResult = 1;
+		ctx->exactPts = framePts;
+
+		if (framePts >= pts)
+		{
+			// wanted frame, or first frame of stream if pts is before it
+			ctx->lastDecodedPts = framePts;
+			ctx->canContinueDecoding = 1;
+			break;
+		}
 	}
 
-	if (playback->selectedAudioStream != -1)
+	// decoder has to be usable again after it was drained
+	if (isDraining)
 	{
-		const AVCodecParameters* codecParams = ctx->format->streams[playback->selectedAudioStream]->codecpar;
-		const AVCodec* codec = avcodec_find_decoder(codecParams->codec_id);
+		avcodec_flush_buffers(codec);
+		ctx->canContinueDecoding = 0;
+	}
 
-		ctx->codecAudio = avcodec_alloc_context3(codec);
-		ret = avcodec_parameters_to_context(ctx->codecAudio, codecParams);
-		ret = avcodec_open2(ctx->codecAudio, codec, NULL /*no options*/);
-		ctx->ctx.audio.channelCount = ctx->codecAudio->ch_layout.nb_channels;
-		ctx->ctx.audio.decodedSampleRate = ctx->ctx.audio.originalSampleRate = ctx->codecAudio->sample_rate;
+	av_frame_free(&frame);
+	if (ret)
+		return -1;
 
-		ctx->ctx.audio.decodedChannelLayout = ctx->ctx.audio.originalChannelLayout =
-			FromChannelLayoutToEnum(ctx->codecAudio->ch_layout);
-		ctx->ctx.audio.decodedSampleFormat = SAMPLE_FORMAT_FLOAT;
+	// no frame at or after pts, shown frame is kept
+	return hasResult ? 0 : 1;
+}
 
-		if (ctx->ctx.audio.channelCount <= 0 || ctx->ctx.audio.originalSampleRate <= 0 ||
-			ctx->ctx.audio.originalChannelLayout <= 0 || ctx->ctx.audio.decodedSampleFormat <= 0)
+/// @return 0 on success, 1 if there is no frame at or after pts, -1 on error
+static int MediaDecoder_ShowFrame(InternalContext* ctx, int64_t pts)
+{
+	MediaDecoderVideoInfo* video = &ctx->ctx.video;
+	const FrameCacheEntry* entry = NULL;
+	int ret;
+	if (ctx->frameCacheMode != FRAME_CACHE_OFF)
+		entry = FrameCache_Find(ctx->frameCache, pts);
+
+	// cached image can only be used if it fits frameBuffer
+	if (entry && !entry->frame && (ctx->cachedImage || !video->frameBuffer || entry->size != video->bytesPerFrame))
+		entry = NULL;
+
+	if (entry && !entry->frame)
+	{
+		memcpy(video->frameBuffer, entry->buffer, entry->size);
+		ctx->exactPts = entry->pts;
+		ctx->funcDecodeFrame = &MediaDecoder_DecodeFrame_Done;
+	}
+	else
+	{
+		if (entry)
 		{
-			// in case that one value is not set, set all to zero, these will be later set when first frame is read
-			ctx->ctx.audio.channelCount = ctx->ctx.audio.decodedSampleRate = ctx->ctx.audio.originalSampleRate =
-				ctx->ctx.audio.decodedChannelLayout = ctx->ctx.audio.originalChannelLayout = 0;
+			av_frame_unref(ctx->frame);
+			if (av_frame_ref(ctx->frame, entry->frame) < 0)
+				return -1;
+			ctx->exactPts = entry->pts;
+		}
+		else if ((ret = MediaDecoder_DecodeUntil(ctx, pts)) != 0)
+		{
+			return ret;
+		}
+		else if (ctx->frameCacheMode == FRAME_CACHE_CONVERTED)
+		{
+			// wanted frame was converted while it was cached
+			entry = FrameCache_Find(ctx->frameCache, ctx->exactPts);
+			if (entry &&
+				(entry->frame || ctx->cachedImage || !video->frameBuffer || entry->size != video->bytesPerFrame))
+				entry = NULL;
+		}
+
+		// frame is converted by MediaDecoder_DecodeFrame(), unless it is a copy of cached image
+		if (MediaDecoder_SetReadFrame(ctx, ctx->codecVideo, ctx->frame, NULL))
+			return -1;
+		if (entry && !entry->frame)
+		{
+			memcpy(video->frameBuffer, entry->buffer, entry->size);
+			ctx->funcDecodeFrame = &MediaDecoder_DecodeFrame_Done;
 		}
+	}
+
+	const AVStream* stream = ctx->format->streams[ctx->ctx.playback.selectedVideoStream];
+	ctx->ctx.playback.position = ctx->exactPts * av_q2d(stream->time_base);
+	ctx->shownPts = ctx->exactPts;
+	return 0;
+}
+
+static int MediaDecoder_ConvertTensorFrame(
+	InternalContext* ctx, const MediaDecoderTensorInfo* tensor, uint32_t index, uint8_t* temp
+)
+{
+	const AVFrame* frame = ctx->frame;
+	size_t planeSize = (size_t)tensor->width * tensor->height;
+
+	// 8bit samples are written straight into tensor, float samples are normalized from temporary buffer
+	uint8_t* out = temp ? temp : (uint8_t*)tensor->data + index * 3 * planeSize;
+	uint8_t* outImageData[] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+	int outImageLineSize[] = {0, 0, 0, 0, 0, 0, 0, 0};
+	enum AVPixelFormat format;
+	if (tensor->layout == TENSOR_LAYOUT_NCHW)
+	{
+		// planes of GBRP are in order green, blue, red
+		format = AV_PIX_FMT_GBRP;
+		outImageData[0] = out + planeSize;
+		outImageData[1] = out + 2 * planeSize;
+		outImageData[2] = out;
+		outImageLineSize[0] = outImageLineSize[1] = outImageLineSize[2] = tensor->width;
+	}
+	else
+	{
+		format = AV_PIX_FMT_RGB24;
+		outImageData[0] = out;
+		outImageLineSize[0] = tensor->width * 3;
+	}
+
+	// own resizer, so that scaler of video output is not rebuilt for every tensor frame
+	if (!ctx->tensorResizer)
+	{
+		ctx->tensorResizer = ImageResizer_CreateContext();
+		if (!ctx->tensorResizer)
+			return -1;
+	}
+	ImageResizer_SetQuality(ctx->tensorResizer, tensor->scaleQuality);
+	if (!ImageResizer_SetParameters(
+			ctx->tensorResizer, frame->width, frame->height, frame->format | 0x10000, tensor->width, tensor->height,
+			format | 0x10000
+		))
+	{
+		return -1;
+	}
+	ImageResizer_Resize(
+		ctx->tensorResizer, (const uint8_t**)frame->data, frame->linesize, outImageData, outImageLineSize
+	);
+
+	if (temp)
+	{
+		float scale[3];
+		float bias[3];
+		for (int c = 0; c < 3; c++)
+		{
+			float std = tensor->std[c] != 0.0f ? tensor->std[c] : 1.0f;
+			scale[c] = 1.0f / (255.0f * std);
+			bias[c] = -tensor->mean[c] / std;
+		}
+
+		float* outTensor = (float*)tensor->data + index * 3 * planeSize;
+		if (tensor->layout == TENSOR_LAYOUT_NCHW)
+			TensorConverter_NormalizePlanar(temp, outTensor, planeSize, scale, bias);
+		else
+			TensorConverter_NormalizeInterleaved(temp, outTensor, planeSize, scale, bias);
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void MediaDecoder_SetLowDelay(AVCodecContext* codec)
+{
+	// frame threading holds back one frame per thread
+	codec->flags |= AV_CODEC_FLAG_LOW_DELAY;
+	codec->thread_type = FF_THREAD_SLICE;
+}
+
+static int MediaDecoder_ReadLivePacket(InternalContext* ctx)
+{
+	if (ctx->hasLivePacket)
+	{
+		ctx->hasLivePacket = 0;
+		av_packet_move_ref(ctx->packet, ctx->livePacket);
+		return 0;
+	}
+	return av_read_frame(ctx->format, ctx->packet);
+}
+
+static int MediaDecoder_NextFrame_Live(InternalContext* ctx, uint32_t* streamIndex)
+{
+	MediaDecoderContext* context = &ctx->ctx;
+	if (ctx->audioBlockPending)
+	{
+		// resampler may still hold enough samples for another block
+		int ret = MediaDecoder_FillAudioBlock(ctx, NULL);
+		if (ret < 0)
+			return -1;
+		if (ret == 1)
+		{
+			if (streamIndex)
+				*streamIndex = context->playback.selectedAudioStream;
+			ctx->funcDecodeFrame = &MediaDecoder_DecodeFrame_Done;
+			return 0;
+		}
+	}
+
+	int hasVideo = 0;
+	for (;;)
+	{
+		// newest decoded video frame is kept in ctx->frame, every following one replaces it
+		if (ctx->codecVideo && avcodec_receive_frame(ctx->codecVideo, ctx->liveFrame) == 0)
+		{
+			if (hasVideo)
+				context->playback.droppedFrames++;
+			av_frame_unref(ctx->frame);
+			av_frame_move_ref(ctx->frame, ctx->liveFrame);
+			hasVideo = 1;
+			continue;
+		}
+
+		// every decoded audio frame is returned before more input is sent, so that decoder never refuses a packet
+		if (!hasVideo && ctx->codecAudio && avcodec_receive_frame(ctx->codecAudio, ctx->frame) == 0)
+		{
+			if (context->audio.blockSizePerChannel)
+			{
+				int ret = MediaDecoder_FillAudioBlock(ctx, ctx->frame);
+				if (ret < 0)
+					return -1;
+				if (ret == 0)
+					continue;
+			}
+			return MediaDecoder_SetReadFrame(ctx, ctx->codecAudio, ctx->frame, streamIndex);
+		}
+
+		// everything that already arrived is read, until demuxer would have to wait for more
+		int ret = MediaDecoder_ReadLivePacket(ctx);
+		if (ret == AVERROR(EAGAIN))
+		{
+			if (hasVideo)
+				break;
+			av_usleep(LIVE_POLL_INTERVAL);
+			continue;
+		}
+		if (ret < 0)
+		{
+			if (hasVideo)
+				break;
+			return ret == AVERROR_EOF ? 1 : -1;
+		}
+
+		if (ctx->packet->stream_index == context->playback.selectedVideoStream)
+		{
+			avcodec_send_packet(ctx->codecVideo, ctx->packet);
+			av_packet_unref(ctx->packet);
+			continue;
+		}
+
+		if (ctx->packet->stream_index != context->playback.selectedAudioStream)
+		{
+			av_packet_unref(ctx->packet);
+			continue;
+		}
+
+		// audio frames are received at top of loop once no video frame waits to be returned. packet that decoder
+		// refuses until then is kept for next call, so that reading only stops early when audio would be lost
+		ret = avcodec_send_packet(ctx->codecAudio, ctx->packet);
+		if (ret == AVERROR(EAGAIN))
+		{
+			av_packet_move_ref(ctx->livePacket, ctx->packet);
+			ctx->hasLivePacket = 1;
+			if (hasVideo)
+				break;
+			continue;
+		}
+		av_packet_unref(ctx->packet);
+	}
+
+	return MediaDecoder_SetReadFrame(ctx, ctx->codecVideo, ctx->frame, streamIndex);
+}
+
+static int MediaDecoder_IsImageSequence(const AVFormatContext* format, const AVCodecParameters* codecParams)
+{
+	// only frames of intra only codecs can be decoded independently of each other
+	const AVCodecDescriptor* descriptor = avcodec_descriptor_get(codecParams->codec_id);
+	return !strncmp(format->iformat->name, "image2", 6) && descriptor &&
+		   (descriptor->props & AV_CODEC_PROP_INTRA_ONLY);
+}
+
+static int MediaDecoder_NextFrame_Sequence(InternalContext* ctx, uint32_t* streamIndex)
+{
+	MediaDecoderVideoInfo* video = &ctx->ctx.video;
+	SequenceOutput output = {video->decodedWidth, video->decodedHeight, video->decodedPixelFormat, video->scaleQuality};
+	// caller owned mip chain and views are converted by MediaDecoder_DecodeFrame()
+	output.convert = video->decodedWidth > 0 && video->decodedHeight > 0 && video->mipLevelCount == 0 &&
+					 ctx->renditionCount == 0 && !ctx->governor && !ctx->isDecodingTensor;
+
+	// following frames are decoded on worker threads while oldest one is waited for
+	int ret = 0;
+	while (!SequenceDecoder_IsFull(ctx->sequence) && (ret = av_read_frame(ctx->format, ctx->packet)) == 0)
+	{
+		if (ctx->packet->stream_index == ctx->ctx.playback.selectedVideoStream)
+			ret = SequenceDecoder_Push(ctx->sequence, ctx->packet, &output);
+		av_packet_unref(ctx->packet);
+		if (ret)
+			return -1;
+	}
+	if (ret != 0 && ret != AVERROR_EOF)
+		return -1;
+
+	ret = SequenceDecoder_Take(ctx->sequence, ctx->frame, &output, &video->frameBuffer, &video->bytesPerFrame);
+	if (ret < 0)
+		return ret == AVERROR_EOF ? AVERROR_EOF : -1;
+
+	if (MediaDecoder_SetReadFrame(ctx, ctx->codecVideo, ctx->frame, streamIndex))
+		return -1;
+	if (ret == 1)
+	{
+		// frame was converted by worker already
+		video->planeCount = FillPlaneInfo(
+			video->decodedPixelFormat, video->decodedWidth, video->decodedHeight, video->frameBuffer, video->planes
+		);
+		MediaDecoder_NextFrame_Common(ctx, ctx->ctx.playback.selectedVideoStream);
+		ctx->funcDecodeFrame = &MediaDecoder_DecodeFrame_Done;
+	}
+	return 0;
+}
+
+static MediaDecoderContext* MediaDecoder_OpenInternal(const char* url, const AVIOInterruptCB* interrupt, int isLive);
+
+MediaDecoderContext* MediaDecoder_Open(const char* url)
+{
+	return MediaDecoder_OpenInterruptible(url, NULL);
+}
+
+MediaDecoderContext* MediaDecoder_OpenLive(const char* url)
+{
+	return MediaDecoder_OpenInternal(url, NULL, 1);
+}
+
+MediaDecoderContext* MediaDecoder_OpenInterruptible(const char* url, const AVIOInterruptCB* interrupt)
+{
+	return MediaDecoder_OpenInternal(url, interrupt, 0);
+}
+
+static MediaDecoderContext* MediaDecoder_OpenInternal(const char* url, const AVIOInterruptCB* interrupt, int isLive)
+{
+	int budget = Allocator_CheckBudget();
+	if (budget < 0)
+		return NULL;
+
+	InternalContext* ctx = Allocator_Calloc(1, sizeof(*ctx));
+	if (!ctx)
+		return NULL;
+
+	// open container file and loop through each stream
+	ctx->format = avformat_alloc_context();
+	if (interrupt)
+		ctx->format->interrupt_callback = *interrupt;
+	if (isLive)
+	{
+		// start with first packets instead of analyzing several seconds of input
+		ctx->format->flags |= AVFMT_FLAG_NOBUFFER | AVFMT_FLAG_FLUSH_PACKETS;
+		ctx->format->probesize = LIVE_PROBE_SIZE;
+	}
+	int ret;
+	ret = avformat_open_input(&ctx->format, url, NULL /*autodetect fileformat*/, NULL /*no options*/);
+	if (ret < 0)
+	{
+		Allocator_Free(ctx);
+		return NULL;
+	}
+
+	ctx->url = Allocator_StrDup(url);
+
+	if (isLive)
+	{
+		// probing is done, from now on reading returns right away when nothing arrived
+		ctx->format->flags |= AVFMT_FLAG_NONBLOCK;
+		ctx->isLive = 1;
+		ctx->liveFrame = av_frame_alloc();
+		ctx->livePacket = av_packet_alloc();
+	}
+
+	// allocate packet and frame, so we can use them when decoding
+	ctx->packet = av_packet_alloc();
+	ctx->frame = av_frame_alloc();
+#ifndef DISABLE_HARDWARE_ACCELERATION
+	ctx->frame2 = av_frame_alloc();
+#endif
+
+	// set default values for context
+	MediaDecoderPlaybackInfo* playback = &ctx->ctx.playback;
+	playback->streamCount = ctx->format->nb_streams;
+	playback->selectedVideoStream = playback->selectedAudioStream = playback->selectedSubtitleStream = -1;
+
+	ctx->codecVideo = NULL;
+	ctx->ctx.video.frameBuffer = NULL;
+	ctx->ctx.video.planeCount = 0;
+	ctx->resizer = NULL;
+	ctx->tensorResizer = NULL;
+
+	ctx->codecAudio = NULL;
+	ctx->ctx.audio.frameBuffer = NULL;
+	ctx->ctx.audio.sampleCountPerChannel = 0;
+	ctx->ctx.audio.channelCount = 0;
+	ctx->ctx.audio.frameBuffer = NULL;
+	ctx->isImage = 0;
+	ctx->resampler = NULL;
+
+	// TODO: use av_find_best_stream(...)
+	// av_find_best_stream(ctx->format, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, NULL);
+
+	for (unsigned int i = 0; i < ctx->format->nb_streams; i++)
+	{
+		AVStream* stream = ctx->format->streams[i];
+		if (playback->selectedVideoStream == -1 && stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+		{
+			playback->selectedVideoStream = i;
+			ctx->ctx.video.originalWidth = ctx->ctx.video.decodedWidth = stream->codecpar->width;
+			ctx->ctx.video.originalHeight = ctx->ctx.video.decodedHeight = stream->codecpar->height;
+			ctx->ctx.video.decodedPixelFormat = PIXEL_FORMAT_R8G8B8A8_UINT;
+			if (ctx->ctx.video.decodedWidth > 0 && ctx->ctx.video.decodedHeight > 0)
+			{
+				ctx->ctx.video.bytesPerFrame = av_image_get_buffer_size(
+					MapPixelFormat(ctx->ctx.video.decodedPixelFormat), ctx->ctx.video.decodedWidth,
+					ctx->ctx.video.decodedHeight, 1
+				);
+			}
+			else
+			{
+				ctx->ctx.video.bytesPerFrame = 0;
+			}
+		}
+		else if (playback->selectedAudioStream == -1 && stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)
+		{
+			playback->selectedAudioStream = i;
+		}
+		else if (playback->selectedSubtitleStream == -1 && stream->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE)
+		{
+			playback->selectedSubtitleStream = i;
+		}
+	}
+
+	playback->position = 0.0;
+	playback->duration = 0.0;
+
+	if (!isLive && playback->selectedVideoStream != -1 && playback->selectedAudioStream == -1 &&
+		ctx->format->duration == AV_NOPTS_VALUE)
+	{
+		// assume that if we can not know or estimate duration of media,
+		// then it probably only has one frame, which means that it must be an image.
+		ctx->isImage = 1;
+	}
+
+	for (int i = 0; i < sizeof(playback->selectedStreams) / sizeof(*playback->selectedStreams); i++)
+	{
+		if (playback->selectedStreams[i] == -1)
+			continue;
+
+		AVStream* stream = ctx->format->streams[playback->selectedStreams[i]];
+
+		if (stream->duration != AV_NOPTS_VALUE)
+		{
+			double d = (double)stream->duration * stream->time_base.num / stream->time_base.den;
+			if (d > playback->duration)
+				playback->duration = d / 1000.0;
+
+			AVRational r = stream->avg_frame_rate;
+			if (r.den > 0)
+			{
+				int64_t frameCount = stream->duration * r.num / r.den;
+				// ctx->isImage = frameCount == 1;
+			}
+		}
+		if (ctx->format->duration != AV_NOPTS_VALUE)
+		{
+			double d = (double)ctx->format->duration * stream->time_base.num / stream->time_base.den;
+			if (d > playback->duration)
+				playback->duration = d / 1000.0;
+		}
+
+		if (stream->nb_frames != 0)
+		{
+			// ctx->isImage = stream->nb_frames == 1;
+		}
+	}
+
+	if (playback->selectedVideoStream != -1)
+	{
+		// prepare correct video codec, try to setup hardware accelerated decoder
+		const AVCodecParameters* codecParams = ctx->format->streams[playback->selectedVideoStream]->codecpar;
+		const AVCodec* codec = avcodec_find_decoder(codecParams->codec_id);
+
+		ctx->codecVideo = avcodec_alloc_context3(codec);
+		avcodec_parameters_to_context(ctx->codecVideo, codecParams);
+		ctx->codecVideo->get_buffer2 = &Allocator_GetBuffer2;
+		if (isLive)
+			MediaDecoder_SetLowDelay(ctx->codecVideo);
+
+		enum AVHWDeviceType type = AV_HWDEVICE_TYPE_NONE;
+
+#ifndef DISABLE_HARDWARE_ACCELERATION
+		int i = 0;
+		while (i >= 0)
+		{
+			const AVCodecHWConfig* hwConfig = avcodec_get_hw_config(codecVideo, i);
+			if (!hwConfig)
+			{
+				break;
+			}
+
+			if (hwConfig->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX)
+			{
+				type = AV_HWDEVICE_TYPE_NONE;
+				while ((type = av_hwdevice_iterate_types(type)) != AV_HWDEVICE_TYPE_NONE)
+				{
+					if (hwConfig->device_type == type)
+					{
+						hw_pix_fmt = hwConfig->pix_fmt;
+						if (hw_decoder_init(ctx->codecVideo, type) < 0)
+						{
+							// couldnt initialize hardware decoder, continue searching
+							hw_pix_fmt = AV_PIX_FMT_NONE;
+							continue;
+						}
+						i = -1;
+						break;
+					}
+				}
+				if (i == -1)
+					break;
+			}
+
+			i++;
+		}
+#endif
+
+		if (type == AV_HWDEVICE_TYPE_NONE)
+		{
+			// printf("using softwaredecoding.\n");
+		}
+
+		avcodec_open2(ctx->codecVideo, codec, NULL /*no options*/);
+
+		ctx->resizer = ImageResizer_CreateContext();
+
+		// image sequences have no audio stream that would have to be decoded in between
+		if (!ctx->isImage && playback->selectedAudioStream == -1 &&
+			MediaDecoder_IsImageSequence(ctx->format, codecParams))
+		{
+			ctx->sequence = SequenceDecoder_Create(codecParams);
+		}
+
+		if (budget > 0 && ctx->ctx.video.decodedWidth > 1 && ctx->ctx.video.decodedHeight > 1)
+		{
+			// memory budget is exceeded, decode video at half size, which also enables preview decoding
+			ctx->ctx.video.decodedWidth /= 2;
+			ctx->ctx.video.decodedHeight /= 2;
+			ctx->ctx.video.bytesPerFrame = av_image_get_buffer_size(
+				MapPixelFormat(ctx->ctx.video.decodedPixelFormat), ctx->ctx.video.decodedWidth,
+				ctx->ctx.video.decodedHeight, 1
+			);
+		}
+	}
+
+	if (playback->selectedAudioStream != -1)
+	{
+		const AVCodecParameters* codecParams = ctx->format->streams[playback->selectedAudioStream]->codecpar;
+		const AVCodec* codec = avcodec_find_decoder(codecParams->codec_id);
+
+		ctx->codecAudio = avcodec_alloc_context3(codec);
+		ret = avcodec_parameters_to_context(ctx->codecAudio, codecParams);
+		if (isLive)
+			MediaDecoder_SetLowDelay(ctx->codecAudio);
+		ret = avcodec_open2(ctx->codecAudio, codec, NULL /*no options*/);
+		ctx->ctx.audio.channelCount = ctx->codecAudio->ch_layout.nb_channels;
+		ctx->ctx.audio.decodedSampleRate = ctx->ctx.audio.originalSampleRate = ctx->codecAudio->sample_rate;
+
+		ctx->ctx.audio.decodedChannelLayout = ctx->ctx.audio.originalChannelLayout =
+			FromChannelLayoutToEnum(ctx->codecAudio->ch_layout);
+		ctx->ctx.audio.decodedSampleFormat = SAMPLE_FORMAT_FLOAT;
+
+		if (ctx->ctx.audio.channelCount <= 0 || ctx->ctx.audio.originalSampleRate <= 0 ||
+			ctx->ctx.audio.originalChannelLayout <= 0 || ctx->ctx.audio.decodedSampleFormat <= 0)
+		{
+			// in case that one value is not set, set all to zero, these will be later set when first frame is read
+			ctx->ctx.audio.channelCount = ctx->ctx.audio.decodedSampleRate = ctx->ctx.audio.originalSampleRate =
+				ctx->ctx.audio.decodedChannelLayout = ctx->ctx.audio.originalChannelLayout = 0;
+		}
+
+		ctx->resampler = SoundResampler_CreateContext();
+	}
+
+	ctx->didPlaybackStart = 0;
+	ctx->exactPts = AV_NOPTS_VALUE;
+	ctx->shownPts = AV_NOPTS_VALUE;
+
+	// interrupt callback is only meant for opening, its opaque may not outlive this call
+	ctx->format->interrupt_callback.callback = NULL;
+	ctx->format->interrupt_callback.opaque = NULL;
+
+	return (MediaDecoderContext*)ctx;
+}
+
+int MediaDecoder_IsImage(MediaDecoderContext* context)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	return ctx->isImage == 1 || ctx->isImage == 2;
+}
+
+int MediaDecoder_Play(MediaDecoderContext* context, double time)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (!ctx->didPlaybackStart)
+	{
+		ctx->didPlaybackStart = 1;
+		ctx->loopCount = 0;
+		ctx->lastTime = time;
+		ctx->startTime = time;
+	}
+
+	time -= ctx->startTime;
+
+	int ret;
+	if (context->playback.position <= time)
+	{
+		ret = MediaDecoder_NextFrame(context, NULL);
+		if (ret == 0 && (ctx->didLoop || ctx->didSwitch))
+		{
+			// media continued at its start or with next media without reaching end
+			if (ctx->didLoop)
+				ctx->loopCount++;
+			ctx->didLoop = 0;
+			ctx->didSwitch = 0;
+			ctx->startTime = time + ctx->startTime;
+			ctx->lastTime = 0;
+			return ret;
+		}
+		if (ret == 1)
+		{
+			ret = MediaDecoder_Seek(context, 0);
+			if (!ret)
+			{
+				ctx->startTime = time + ctx->startTime;
+				ctx->lastTime = 0;
+				ctx->loopCount++;
+				return ret;
+			}
+		}
+	}
+	else
+	{
+		ret = 0;
+	}
+
+	if (ret == 0)
+		ctx->lastTime = time;
+	return ret;
+}
+
+int MediaDecoder_NextFrame(MediaDecoderContext* context, uint32_t* streamIndex)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (ctx->isSuspended)
+		return -1;
+
+	if (ctx->isImage == 2)
+	{
+		// detected stream with a single frame
+		return 1;
+	}
+
+	if (ctx->isImage == 1 && !ctx->didCheckImageCache && !MediaDecoder_NextFrame_CachedImage(ctx, streamIndex))
+	{
+		// same image was already converted by another context
+		return 0;
+	}
+
+	if (ctx->isLive)
+		return MediaDecoder_NextFrame_Live(ctx, streamIndex);
+
+	MediaDecoder_StartPreroll(ctx);
+
+	// packets are read from wherever decoder stopped, so exact seeks have to seek again
+	ctx->canContinueDecoding = 0;
+
+	if (ctx->audioBlockPending)
+	{
+		// resampler may still hold enough samples for another block
+		int ret = MediaDecoder_FillAudioBlock(ctx, NULL);
+		if (ret < 0)
+			return -1;
+		if (ret == 1)
+		{
+			if (streamIndex)
+				*streamIndex = context->playback.selectedAudioStream;
+			ctx->funcDecodeFrame = &MediaDecoder_DecodeFrame_Done;
+			return 0;
+		}
+	}
+
+	// read next frame, only time spent in video decoder counts towards cost of frame, not reading or audio
+	int64_t decodeTime = 0;
+	int ret;
+	AVFrame* softwareFrame = ctx->frame;
+	AVCodecContext* codec = NULL;
+	if (ctx->sequence)
+	{
+		ret = MediaDecoder_NextFrame_Sequence(ctx, streamIndex);
+		if (ret != AVERROR_EOF)
+			return ret;
+	}
+	while (!ctx->sequence && (ret = MediaDecoder_ReadPacket(ctx)) >= 0)
+	{
+		// frame of previous video decoder, see MediaDecoder_UpdatePreview()
+		if (ret == 1)
+			codec = ctx->codecVideo;
+		else if (ctx->packet->stream_index == context->playback.selectedVideoStream)
+			codec = ctx->codecVideo;
+		else if (ctx->packet->stream_index == context->playback.selectedAudioStream)
+			codec = ctx->codecAudio;
+		else
+			codec = NULL;
+
+		if (!codec)
+		{
+			av_packet_unref(ctx->packet);
+			continue;
+		}
+
+		if (ret == 0 && codec == ctx->codecVideo && (ctx->packet->flags & AV_PKT_FLAG_KEY))
+		{
+			MediaDecoder_UpdatePreview(ctx);
+			codec = ctx->codecVideo;
+		}
+
+		if (ret == 0 && codec == ctx->codecVideo && ctx->codecPrevious)
+		{
+			MediaDecoder_SendSwitchPacket(ctx);
+			continue;
+		}
+
+		if (codec == ctx->codecVideo && ctx->governor)
+			codec->skip_frame = ctx->governorLevel >= GOVERNOR_LEVEL_SKIP_NONREF ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+
+		if (ret == 0)
+		{
+			int64_t sendTime = av_gettime_relative();
+			ret = avcodec_send_packet(codec, ctx->packet);
+			ret = avcodec_receive_frame(codec, ctx->frame);
+			if (codec == ctx->codecVideo)
+				decodeTime += av_gettime_relative() - sendTime;
+			if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+			{
+				av_packet_unref(ctx->packet);
+				continue;
+			}
+
+			av_packet_unref(ctx->packet);
+		}
+
+		// one frame was read
+
+#ifndef DISABLE_HARDWARE_ACCELERATION
+		if (ctx->frame->format == hw_pix_fmt)
+		{
+			int64_t transferTime = av_gettime_relative();
+			if (av_hwframe_transfer_data(ctx->frame2, ctx->frame, AV_HWFRAME_TRANSFER_DIRECTION_FROM) < 0)
+				return -1;
+			decodeTime += av_gettime_relative() - transferTime;
+
+			softwareFrame = ctx->frame2;
+		}
+#endif
+
+		if (codec == ctx->codecVideo && ctx->governor && MediaDecoder_ReportGovernor(ctx, decodeTime))
+		{
+			// frame is dropped to halve frame rate
+			decodeTime = 0;
+			continue;
+		}
+
+		if (codec == ctx->codecAudio && context->audio.blockSizePerChannel)
+		{
+			// audio is resampled right away, frame is only returned once block is full
+			ret = MediaDecoder_FillAudioBlock(ctx, softwareFrame);
+			if (ret < 0)
+				return -1;
+			if (ret == 0)
+				continue;
+		}
+
+		ret = 0;
+		break;
+	}
+
+	if (ret == AVERROR_EOF && ctx->next)
+	{
+		// all samples of current media must be delivered before samples of next media
+		if (MediaDecoder_FlushAudio(ctx, 0))
+		{
+			if (streamIndex)
+				*streamIndex = context->playback.selectedAudioStream;
+			ctx->funcDecodeFrame = &MediaDecoder_DecodeFrame_Done;
+			return 0;
+		}
+
+		if (!MediaDecoder_ContinueWithNext(ctx))
+			return MediaDecoder_NextFrame_Prerolled(ctx, streamIndex);
+
+		// next media could not be opened, so incomplete last block is padded and delivered like at end of media
+		ctx->audioFlushed = 0;
+	}
+
+	if (ret == AVERROR_EOF && context->playback.seamlessLoop && !ctx->isImage && !MediaDecoder_LoopSeamless(ctx))
+		return MediaDecoder_NextFrame_Prerolled(ctx, streamIndex);
+
+	if (ret != 0)
+	{
+		if (ret == AVERROR_EOF)
+		{
+			if (MediaDecoder_FlushAudio(ctx, 1))
+			{
+				// return samples that were still inside resampler
+				if (streamIndex)
+					*streamIndex = context->playback.selectedAudioStream;
+				ctx->funcDecodeFrame = &MediaDecoder_DecodeFrame_Done;
+				return 0;
+			}
+
+			// update if duration is inaccurate
+			context->playback.duration = context->playback.position;
+
+			// no need to seek, because its only one frame
+			if (context->playback.duration == 0.0)
+			{
+				ctx->isImage = 2;
+			}
+
+			return 1;
+		}
+		else
+		{
+			char* str = av_err2str(ret);
+			// error reading/decoding/demuxing frame
+			return -1;
+		}
+	}
+
+	return MediaDecoder_SetReadFrame(ctx, codec, softwareFrame, streamIndex);
+}
+
+int MediaDecoder_DecodeFrame(MediaDecoderContext* context)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (ctx->isSuspended || !ctx->funcDecodeFrame)
+		return -1;
+	if (ctx->funcDecodeFrame != &MediaDecoder_NextFrame_Video)
+		return ctx->funcDecodeFrame(context);
+
+	// conversion time is added to cost of frame, see MediaDecoder_ReportGovernor()
+	int64_t startTime = av_gettime_relative();
+	int ret = MediaDecoder_NextFrame_Video(context);
+	if (ret == 0 && ctx->renditionCount > 0)
+		ret = MediaDecoder_ConvertRenditions(ctx);
+	ctx->convertTime += av_gettime_relative() - startTime;
+	return ret;
+}
+
+int MediaDecoder_Seek(MediaDecoderContext* context, double time)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (ctx->isSuspended)
+		return -1;
+
+	for (int si = 0; si < sizeof(context->playback.selectedStreams) / sizeof(*context->playback.selectedStreams); si++)
+	{
+		if (context->playback.selectedStreams[si] != -1)
+		{
+			AVStream* stream = ctx->format->streams[context->playback.selectedStreams[si]];
+
+			AVRational timebase = stream->time_base;
+			int64_t shortTime = (int64_t)(0.1 * timebase.den / timebase.num);
+			if (shortTime < 1)
+				shortTime = 1;
+
+			int64_t ts = (int64_t)(time * timebase.den / timebase.num);
+			int64_t min = ts - shortTime;
+			int64_t max = ts + shortTime;
+
+			int ret = avformat_seek_file(ctx->format, -1, INT64_MIN, ts, INT64_MAX, 0);
+			if (ret < 0)
+			{
+				char* str = av_err2str(ret);
+				return -1;
+			}
+			break;
+		}
+	}
+
+	MediaDecoder_ResetAudio(ctx);
+	MediaDecoder_CancelSwitch(ctx);
+	ctx->canContinueDecoding = 0;
+	if (ctx->sequence)
+		SequenceDecoder_Cancel(ctx->sequence);
+
+	if (MediaDecoder_NextFrame(context, NULL))
+		return -1;
+	if (MediaDecoder_NextFrame(context, NULL))
+		return -1;
+
+	context->playback.position = time;
+	return 0;
+}
+
+int MediaDecoder_Close(MediaDecoderContext** context)
+{
+	if (!context || !*context)
+		return 0;
+
+	InternalContext* ctx = (InternalContext*)*context;
+	if (ctx->preroll)
+		MediaDecoder_CancelOpen(&ctx->preroll);
+	if (ctx->next)
+		MediaDecoder_CancelOpen(&ctx->next);
+	if (ctx->frameCache)
+		FrameCache_ReleaseContext(&ctx->frameCache);
+	if (ctx->governor)
+		Governor_Release(ctx->governor);
+	SequenceDecoder_Release(&ctx->sequence);
+	for (uint32_t i = 0; i < ctx->renditionCount; i++)
+		MediaDecoder_FreeRendition(ctx->renditions[i]);
+	Allocator_Free(ctx->renditions);
+	if (ctx->cachedImage)
+		ImageCache_Release(&ctx->cachedImage);
+	else if (ctx->ctx.video.frameBuffer)
+		Allocator_Free(ctx->ctx.video.frameBuffer);
+	if (ctx->ctx.audio.frameBuffer)
+		Allocator_Free(ctx->ctx.audio.frameBuffer);
+	if (ctx->resizer)
+		ImageResizer_ReleaseContext(&ctx->resizer);
+	if (ctx->tensorResizer)
+		ImageResizer_ReleaseContext(&ctx->tensorResizer);
+	if (ctx->resampler)
+		SoundResampler_ReleaseContext(&ctx->resampler);
+	av_packet_free(&ctx->packet);
+	av_packet_free(&ctx->livePacket);
+	av_frame_free(&ctx->liveFrame);
+#ifndef DISABLE_HARDWARE_ACCELERATION
+	av_frame_free(&ctx->frame2);
+#endif
+	av_frame_free(&ctx->frame);
+	MediaDecoder_CancelSwitch(ctx);
+	Allocator_Free(ctx->switchFrames);
+	av_packet_free(&ctx->switchPackets[0]);
+	av_packet_free(&ctx->switchPackets[1]);
+	if (ctx->codecVideo)
+		avcodec_free_context(&ctx->codecVideo);
+	if (ctx->codecAudio)
+		avcodec_free_context(&ctx->codecAudio);
+	avformat_free_context(ctx->format);
+	Allocator_Free(ctx->url);
+	Allocator_Free(ctx->nextUrl);
+	Allocator_Free(*context);
+	*context = NULL;
+	return 0;
+}
+
+int MediaDecoder_QueueNext(MediaDecoderContext* context, const char* url)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (ctx->next)
+		MediaDecoder_CancelOpen(&ctx->next);
+
+	// url may be ctx->nextUrl itself when media is queued again on resume
+	char* nextUrl = url ? Allocator_StrDup(url) : NULL;
+	Allocator_Free(ctx->nextUrl);
+	ctx->nextUrl = nextUrl;
+	if (!url)
+		return 0;
+	if (!nextUrl)
+		return -1;
+
+	// suspended context opens queued media once it is resumed
+	if (ctx->isSuspended)
+		return 0;
+
+	ctx->next = MediaDecoder_PrerollAsync(url);
+	return ctx->next ? 0 : -1;
+}
+
+int MediaDecoder_DecodeTensor(MediaDecoderContext* context, const MediaDecoderTensorInfo* tensor)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (!ctx->codecVideo || !tensor || !tensor->data || tensor->width < 1 || tensor->height < 1)
+		return -1;
+
+	uint8_t* temp = NULL;
+	if (tensor->type == TENSOR_TYPE_FLOAT32)
+	{
+		temp = Allocator_Alloc((size_t)tensor->width * tensor->height * 3);
+		if (!temp)
+			return -1;
+	}
+
+	const AVStream* stream = ctx->format->streams[context->playback.selectedVideoStream];
+	uint32_t frameStep = tensor->frameStep > 0 ? tensor->frameStep : 1;
+	double sampleTime = -1.0;
+	uint64_t frameIndex = 0;
+
+	int written = 0;
+	ctx->isDecodingTensor = 1;
+	while (written < (int)tensor->frameCount)
+	{
+		int ret = MediaDecoder_NextFrame(context, NULL);
+		if (ret == 1)
+			break;
+		if (ret < 0)
+		{
+			written = -1;
+			break;
+		}
+
+		// audio and frames that were already converted are skipped
+		if (ctx->funcDecodeFrame != &MediaDecoder_NextFrame_Video)
+			continue;
+
+		int isSampled;
+		if (tensor->fps > 0.0)
+		{
+			// first frame that is shown at or after sample time, small error is allowed for rounded timestamps
+			double time = ctx->frame->best_effort_timestamp != AV_NOPTS_VALUE
+							   ? ctx->frame->best_effort_timestamp * av_q2d(stream->time_base)
+							   : context->playback.position;
+			if (sampleTime < 0.0)
+				sampleTime = time;
+			isSampled = time >= sampleTime - 1e-6;
+			while (sampleTime <= time + 1e-6)
+				sampleTime += 1.0 / tensor->fps;
+		}
+		else
+		{
+			isSampled = frameIndex % frameStep == 0;
+		}
+		frameIndex++;
+
+		// frames that are not sampled are never converted
+		MediaDecoder_NextFrame_Common(ctx, context->playback.selectedVideoStream);
+		if (!isSampled)
+			continue;
+
+		if (MediaDecoder_ConvertTensorFrame(ctx, tensor, written, temp))
+		{
+			written = -1;
+			break;
+		}
+		written++;
+	}
+	ctx->isDecodingTensor = 0;
+
+	Allocator_Free(temp);
+	return written;
+}
+
+int MediaDecoder_SetGovernor(MediaDecoderContext* context, MediaDecoderGovernor* governor)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (governor)
+		Governor_Retain(governor);
+	if (ctx->governor)
+		Governor_Release(ctx->governor);
+	ctx->governor = governor;
+	ctx->convertTime = 0;
+
+	if (!governor)
+	{
+		// restore full quality right away
+		ctx->governorLevel = GOVERNOR_LEVEL_FULL;
+		if (ctx->codecVideo)
+			ctx->codecVideo->skip_frame = AVDISCARD_DEFAULT;
+	}
+	return 0;
+}
+
+const MediaDecoderVideoInfo* MediaDecoder_AddView(
+	MediaDecoderContext* context, uint32_t width, uint32_t height, MediaDecoderPixelFormat pixelFormat
+)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (!ctx->codecVideo || width < 1 || height < 1)
+		return NULL;
+
+	for (uint32_t i = 0; i < ctx->renditionCount; i++)
+	{
+		MediaDecoderVideoInfo* video = &ctx->renditions[i]->video;
+		if (video->decodedWidth == width && video->decodedHeight == height && video->decodedPixelFormat == pixelFormat)
+		{
+			ctx->renditions[i]->refCount++;
+			return video;
+		}
+	}
+
+	int bytesPerFrame = av_image_get_buffer_size(MapPixelFormat(pixelFormat), width, height, 1);
+	if (bytesPerFrame < 1)
+		return NULL;
+
+	Rendition** tmp = Allocator_Realloc(ctx->renditions, sizeof(*tmp) * (ctx->renditionCount + 1));
+	if (!tmp)
+		return NULL;
+	ctx->renditions = tmp;
+
+	Rendition* rendition = Allocator_Calloc(1, sizeof(*rendition));
+	if (!rendition)
+		return NULL;
+	rendition->refCount = 1;
+	rendition->resizer = ImageResizer_CreateContext();
+	rendition->video.frameBuffer = Allocator_Calloc(1, bytesPerFrame);
+	if (!rendition->resizer || !rendition->video.frameBuffer)
+	{
+		MediaDecoder_FreeRendition(rendition);
+		return NULL;
+	}
+
+	MediaDecoderVideoInfo* video = &rendition->video;
+	video->originalWidth = context->video.originalWidth;
+	video->originalHeight = context->video.originalHeight;
+	video->decodedWidth = width;
+	video->decodedHeight = height;
+	video->decodedPixelFormat = pixelFormat;
+	video->bytesPerFrame = bytesPerFrame;
+	video->planeCount = FillPlaneInfo(pixelFormat, width, height, video->frameBuffer, video->planes);
+
+	// keep larger renditions first, so that smaller ones can be scaled down from them
+	uint32_t index = 0;
+	while (index < ctx->renditionCount &&
+		   (uint64_t)ctx->renditions[index]->video.decodedWidth * ctx->renditions[index]->video.decodedHeight >=
+			   (uint64_t)width * height)
+	{
+		index++;
+	}
+	memmove(&ctx->renditions[index + 1], &ctx->renditions[index], sizeof(*tmp) * (ctx->renditionCount - index));
+	ctx->renditions[index] = rendition;
+	ctx->renditionCount++;
+	return video;
+}
+
+int MediaDecoder_RemoveView(MediaDecoderContext* context, const MediaDecoderVideoInfo* view)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	for (uint32_t i = 0; i < ctx->renditionCount; i++)
+	{
+		Rendition* rendition = ctx->renditions[i];
+		if (&rendition->video != view)
+			continue;
+
+		if (--rendition->refCount > 0)
+			return 0;
+
+		MediaDecoder_FreeRendition(rendition);
+		memmove(&ctx->renditions[i], &ctx->renditions[i + 1], sizeof(*ctx->renditions) * (ctx->renditionCount - i - 1));
+		ctx->renditionCount--;
+		return 0;
+	}
+	return -1;
+}
+
+uint8_t* MediaDecoder_TakeFrameBuffer(MediaDecoderContext* context)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	MediaDecoderVideoInfo* video = &context->video;
+	if (!video->frameBuffer)
+		return NULL;
+
+	if (ctx->cachedImage)
+	{
+		// shared buffer stays with image cache
+		uint8_t* copy = Allocator_Alloc(video->bytesPerFrame);
+		if (copy)
+			memcpy(copy, video->frameBuffer, video->bytesPerFrame);
+		return copy;
+	}
+
+	// planes are filled in again for new buffer by next conversion
+	uint8_t* buffer = video->frameBuffer;
+	video->frameBuffer = NULL;
+	video->bytesPerFrame = 0;
+	return buffer;
+}
+
+void MediaDecoder_FreeBuffer(uint8_t* buffer)
+{
+	Allocator_Free(buffer);
+}
+
+int MediaDecoder_RunTask(void (*func)(void* arg), void* arg)
+{
+	return TaskQueue_Push(func, arg);
+}
+
+int MediaDecoder_SetFrameCache(MediaDecoderContext* context, MediaDecoderFrameCacheMode mode, uint64_t bytes)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (!ctx->frameCache)
+	{
+		ctx->frameCache = FrameCache_CreateContext();
+		if (!ctx->frameCache)
+			return -1;
+	}
+
+	if (mode != ctx->frameCacheMode)
+	{
+		FrameCache_Clear(ctx->frameCache);
+		ctx->canContinueDecoding = 0;
+	}
+	ctx->frameCacheMode = mode;
+	FrameCache_SetBudget(ctx->frameCache, mode == FRAME_CACHE_OFF ? 0 : bytes);
+	return 0;
+}
+
+int MediaDecoder_SeekFrame(MediaDecoderContext* context, double time)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (!ctx->codecVideo)
+		return -1;
+
+	if (ctx->frameCache)
+		MediaDecoder_CheckFrameCache(ctx);
+
+	const AVStream* stream = ctx->format->streams[context->playback.selectedVideoStream];
+	return MediaDecoder_ShowFrame(ctx, llround(time / av_q2d(stream->time_base))) ? -1 : 0;
+}
+
+int MediaDecoder_StepFrame(MediaDecoderContext* context, int count)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (!ctx->codecVideo)
+		return -1;
+
+	if (ctx->frameCache)
+		MediaDecoder_CheckFrameCache(ctx);
+
+	const AVStream* stream = ctx->format->streams[context->playback.selectedVideoStream];
+	if (ctx->exactPts == AV_NOPTS_VALUE)
+		ctx->exactPts = llround(context->playback.position / av_q2d(stream->time_base));
+
+	for (; count != 0; count += count > 0 ? -1 : 1)
+	{
+		const FrameCacheEntry* entry = NULL;
+		if (ctx->frameCacheMode != FRAME_CACHE_OFF)
+			entry = FrameCache_Find(ctx->frameCache, ctx->exactPts);
+
+		// neighbours are known if frames were decoded in one go, otherwise pts right before or after is used
+		int64_t pts;
+		if (count > 0 && entry && entry->nextPts != AV_NOPTS_VALUE)
+			pts = entry->nextPts;
+		else if (count > 0)
+			pts = ctx->exactPts + (entry ? entry->duration : MediaDecoder_GetFrameDuration(ctx, ctx->frame));
+		else if (entry && entry->prevPts != AV_NOPTS_VALUE)
+			pts = entry->prevPts;
+		else
+			pts = ctx->exactPts - 1;
+
+		// decoder may run out of frames after last one, e.g. for intra only streams
+		int64_t lastPts = ctx->exactPts;
+		int ret = MediaDecoder_ShowFrame(ctx, pts);
+		if (ret)
+			return ret;
+
+		if (ctx->exactPts == lastPts && count > 0 && ctx->frameCacheMode != FRAME_CACHE_OFF)
+		{
+			// frame duration was estimated too short, but following frame may have been cached meanwhile
+			entry = FrameCache_Find(ctx->frameCache, lastPts);
+			if (entry && entry->nextPts != AV_NOPTS_VALUE && (ret = MediaDecoder_ShowFrame(ctx, entry->nextPts)) != 0)
+				return ret;
+		}
+
+		// start or end of stream
+		if (ctx->exactPts == lastPts)
+			return 1;
+	}
+
+	return 0;
+}
+
+int MediaDecoder_TakeAudioSamples(MediaDecoderContext* context, float* buffer, uint32_t sampleCountPerChannel)
+{
+	// int readSamples;
+	// if (context->audio.sampleCountPerChannel >= sampleCountPerChannel)
+	//	readSamples = sampleCountPerChannel * context->audio.channelCount;
+	// else
+	//	readSamples = context->audio.sampleCountPerChannel * context->audio.channelCount;
+
+	// if (readSamples)
+	//{
+	//	memcpy(buffer, context->audio.frameBuffer, sizeof(float) * readSamples);
+	//	size_t diff = (context->audio.sampleCountPerChannel * (size_t)context->audio.channelCount) - readSamples;
+	//	memmove(context->audio.frameBuffer, context->audio.frameBuffer + sizeof(float) * readSamples, diff);
+	//	context->audio.sampleCountPerChannel -= (readSamples / context->audio.channelCount);
+	// }
 
-		ctx->resampler = SoundResampler_CreateContext();
-	}
+	// return readSamples;
+	return 0;
+}
 
-	ctx->didPlaybackStart = 0;
+void MediaDecoder_SetImageCacheBudget(uint64_t bytes)
+{
+	ImageCache_SetBudget(bytes);
+}
 
-	return (MediaDecoderContext*)ctx;
+MediaDecoderImageCacheStats MediaDecoder_GetImageCacheStats()
+{
+	return ImageCache_GetStats();
 }
 
-int MediaDecoder_IsImage(MediaDecoderContext* context)
+int MediaDecoder_SetAllocator(const MediaDecoderAllocator* allocator)
 {
-	InternalContext* ctx = (InternalContext*)context;
-	return ctx->isImage == 1 || ctx->isImage == 2;
+	return Allocator_SetAllocator(allocator);
 }
 
-int MediaDecoder_Play(MediaDecoderContext* context, double time)
+void MediaDecoder_SetMemoryBudget(uint64_t bytes, MediaDecoderBudgetPolicy policy)
 {
-	InternalContext* ctx = (InternalContext*)context;
-	if (!ctx->didPlaybackStart)
-	{
-		ctx->didPlaybackStart = 1;
-		ctx->loopCount = 0;
-		ctx->lastTime = time;
-		ctx->startTime = time;
-	}
+	Allocator_SetBudget(bytes, policy);
+}
 
-	time -= ctx->startTime;
+uint64_t MediaDecoder_GetMemoryUsage()
+{
+	return Allocator_GetUsage();
+}
 
-	int ret;
-	if (context->playback.position <= time)
+/// @brief Replace video.frameBuffer by a copy scaled down to width x height, or free it if that is not possible
+static void MediaDecoder_ShrinkFrameBuffer(InternalContext* ctx, uint32_t width, uint32_t height)
+{
+	MediaDecoderVideoInfo* video = &ctx->ctx.video;
+	uint8_t* buffer = NULL;
+	int bytesPerFrame = 0;
+	int planeCount = 0;
+	MediaDecoderPlaneInfo planes[4];
+	if (video->frameBuffer && video->planeCount > 0 && ctx->resizer && width > 0 && height > 0)
 	{
-		ret = MediaDecoder_NextFrame(context, NULL);
-		if (ret == 1)
+		bytesPerFrame = av_image_get_buffer_size(MapPixelFormat(video->decodedPixelFormat), width, height, 1);
+		if (bytesPerFrame > 0)
+			buffer = Allocator_Alloc(bytesPerFrame);
+		if (buffer)
+			planeCount = FillPlaneInfo(video->decodedPixelFormat, width, height, buffer, planes);
+
+		ImageResizer_SetQuality(ctx->resizer, video->scaleQuality);
+		if (planeCount > 0 &&
+			ImageResizer_SetParameters(
+				ctx->resizer, video->planes[0].width, video->planes[0].height, video->decodedPixelFormat, width,
+				height, video->decodedPixelFormat
+			) &&
+			ImageResizer_SetMipChain(ctx->resizer, NULL, 0, video->mipFilter))
 		{
-			ret = MediaDecoder_Seek(context, 0);
-			if (!ret)
+			const uint8_t* inImageData[] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+			int inImageLineSize[] = {0, 0, 0, 0, 0, 0, 0, 0};
+			uint8_t* outImageData[] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+			int outImageLineSize[] = {0, 0, 0, 0, 0, 0, 0, 0};
+			for (uint32_t i = 0; i < video->planeCount; i++)
 			{
-				ctx->startTime = time + ctx->startTime;
-				ctx->lastTime = 0;
-				ctx->loopCount++;
-				return ret;
+				inImageData[i] = video->planes[i].data;
+				inImageLineSize[i] = video->planes[i].stride;
 			}
+			for (int i = 0; i < planeCount; i++)
+			{
+				outImageData[i] = planes[i].data;
+				outImageLineSize[i] = planes[i].stride;
+			}
+			ImageResizer_Resize(ctx->resizer, inImageData, inImageLineSize, outImageData, outImageLineSize);
+		}
+		else
+		{
+			Allocator_Free(buffer);
+			buffer = NULL;
 		}
 	}
+
+	if (ctx->cachedImage)
+		ImageCache_Release(&ctx->cachedImage);
 	else
+		Allocator_Free(video->frameBuffer);
+
+	video->frameBuffer = buffer;
+	video->bytesPerFrame = buffer ? bytesPerFrame : 0;
+	video->planeCount = buffer ? planeCount : 0;
+	if (buffer)
 	{
-		ret = 0;
+		video->decodedWidth = width;
+		video->decodedHeight = height;
+		memcpy(video->planes, planes, sizeof(planes));
 	}
-
-	if (ret == 0)
-		ctx->lastTime = time;
-	return ret;
 }
 
-int MediaDecoder_NextFrame(MediaDecoderContext* context, uint32_t* streamIndex)
+int MediaDecoder_Suspend(MediaDecoderContext* context, uint32_t keepWidth, uint32_t keepHeight)
 {
 	InternalContext* ctx = (InternalContext*)context;
+	if (ctx->isSuspended)
+		return 0;
 
-	if (ctx->isImage == 2)
-	{
-		// detected stream with a single frame
-		return 1;
-	}
+	// live input can not seek back to where it was
+	if (ctx->isLive)
+		return -1;
 
-	// read next frame
-	int ret;
-	AVFrame* softwareFrame = ctx->frame;
-	AVCodecContext* codec = NULL;
-	while ((ret = av_read_frame(ctx->format, ctx->packet)) == 0)
+	// output size is restored on resume, shown frame may be kept at a smaller size until then
+	ctx->suspendedPosition = context->playback.position;
+	ctx->suspendedWidth = context->video.decodedWidth;
+	ctx->suspendedHeight = context->video.decodedHeight;
+	MediaDecoder_ShrinkFrameBuffer(ctx, keepWidth, keepHeight);
+
+	// queued media is opened again on resume, its url stays in ctx->nextUrl
+	if (ctx->preroll)
+		MediaDecoder_CancelOpen(&ctx->preroll);
+	if (ctx->next)
+		MediaDecoder_CancelOpen(&ctx->next);
+	if (ctx->frameCache)
+		FrameCache_Clear(ctx->frameCache);
+	ctx->canContinueDecoding = 0;
+
+	// views keep their last image, only their converters are released
+	for (uint32_t i = 0; i < ctx->renditionCount; i++)
 	{
-		if (ctx->packet->stream_index == context->playback.selectedVideoStream)
-			codec = ctx->codecVideo;
-		else if (ctx->packet->stream_index == context->playback.selectedAudioStream)
-			codec = ctx->codecAudio;
-		else
-			codec = NULL;
+		if (ctx->renditions[i]->resizer)
+			ImageResizer_ReleaseContext(&ctx->renditions[i]->resizer);
+	}
 
-		if (!codec)
-		{
-			av_packet_unref(ctx->packet);
-			continue;
-		}
+	MediaDecoder_ResetAudio(ctx);
+	Allocator_Free(context->audio.frameBuffer);
+	context->audio.frameBuffer = NULL;
+	context->audio.sampleCountPerChannel = 0;
+	context->audio.sampleCapacityPerChannel = 0;
+
+	if (ctx->resizer)
+		ImageResizer_ReleaseContext(&ctx->resizer);
+	if (ctx->tensorResizer)
+		ImageResizer_ReleaseContext(&ctx->tensorResizer);
+	if (ctx->resampler)
+		SoundResampler_ReleaseContext(&ctx->resampler);
+	SequenceDecoder_Release(&ctx->sequence);
+	av_packet_unref(ctx->packet);
+	av_frame_unref(ctx->frame);
+	MediaDecoder_CancelSwitch(ctx);
+	if (ctx->codecVideo)
+		avcodec_free_context(&ctx->codecVideo);
+	if (ctx->codecAudio)
+		avcodec_free_context(&ctx->codecAudio);
+	avformat_close_input(&ctx->format);
+	ctx->previewLevel = 0;
+	ctx->funcDecodeFrame = NULL;
 
-		ret = avcodec_send_packet(codec, ctx->packet);
-		ret = avcodec_receive_frame(codec, ctx->frame);
-		if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
-		{
-			av_packet_unref(ctx->packet);
-			continue;
-		}
+	ctx->isSuspended = 1;
+	return 0;
+}
 
-		av_packet_unref(ctx->packet);
+int MediaDecoder_Resume(MediaDecoderContext* context)
+{
+	InternalContext* ctx = (InternalContext*)context;
+	if (!ctx->isSuspended)
+		return 0;
 
-		// one frame was read
+	// streams are selected the same way as before, so that selected indices of context stay valid
+	InternalContext* source = (InternalContext*)MediaDecoder_OpenInternal(ctx->url, NULL, 0);
+	if (!source)
+		return -1;
+	ctx->format = source->format;
+	ctx->codecVideo = source->codecVideo;
+	ctx->codecAudio = source->codecAudio;
+	ctx->resizer = source->resizer;
+	ctx->resampler = source->resampler;
+	ctx->sequence = source->sequence;
+	source->format = NULL;
+	source->codecVideo = NULL;
+	source->codecAudio = NULL;
+	source->resizer = NULL;
+	source->resampler = NULL;
+	source->sequence = NULL;
+	MediaDecoderContext* opened = &source->ctx;
+	MediaDecoder_Close(&opened);
+
+	for (uint32_t i = 0; i < ctx->renditionCount; i++)
+	{
+		if (!ctx->renditions[i]->resizer)
+			ctx->renditions[i]->resizer = ImageResizer_CreateContext();
+	}
 
-#ifndef DISABLE_HARDWARE_ACCELERATION
-		if (ctx->frame->format == hw_pix_fmt)
-		{
-			if (av_hwframe_transfer_data(ctx->frame2, ctx->frame, AV_HWFRAME_TRANSFER_DIRECTION_FROM) < 0)
-				return -1;
+	ctx->isSuspended = 0;
+	context->video.decodedWidth = ctx->suspendedWidth;
+	context->video.decodedHeight = ctx->suspendedHeight;
+	context->playback.position = ctx->suspendedPosition;
 
-			softwareFrame = ctx->frame2;
-		}
-#endif
+	// media that was queued before suspending is opened in background again
+	if (ctx->nextUrl && MediaDecoder_QueueNext(context, ctx->nextUrl))
+		return -1;
 
-		ret = 0;
-		break;
+	if (ctx->isImage)
+	{
+		// image is read again, most likely from image cache
+		ctx->isImage = 1;
+		ctx->didCheckImageCache = 0;
+		if (MediaDecoder_NextFrame(context, NULL))
+			return -1;
 	}
-
-	if (ret != 0)
+	else if (ctx->codecVideo && ctx->shownPts != AV_NOPTS_VALUE)
 	{
-		if (ret == AVERROR_EOF)
-		{
-			// update if duration is inaccurate
-			context->playback.duration = context->playback.position;
-
-			// no need to seek, because its only one frame
-			if (context->playback.duration == 0.0)
-			{
-				ctx->isImage = 2;
-			}
-
-			return 1;
-		}
-		else
-		{
-			char* str = av_err2str(ret);
-			// error reading/decoding/demuxing frame
+		// decode exactly frame that was shown, not just keyframe before it
+		if (ctx->frameCache)
+			MediaDecoder_CheckFrameCache(ctx);
+		if (MediaDecoder_ShowFrame(ctx, ctx->shownPts))
 			return -1;
-		}
 	}
-
-	if (codec == ctx->codecVideo)
+	else if (ctx->suspendedPosition > 0.0)
 	{
-		if (streamIndex)
-			*streamIndex = ctx->ctx.playback.selectedVideoStream;
+		return MediaDecoder_Seek(context, ctx->suspendedPosition);
+	}
+	else
+	{
+		return 0;
+	}
 
-		// always update original size to support different sized frames
-		context->video.originalWidth = softwareFrame->width;
-		context->video.originalHeight = softwareFrame->height;
+	return MediaDecoder_DecodeFrame(context);
+}
 
-		ctx->funcDecodeFrame = &MediaDecoder_NextFrame_Video;
-	}
-	else if (codec == ctx->codecAudio)
+/// @brief Create output file with a copy of every stream that is mapped to an output stream
+static AVFormatContext* MediaDecoder_OpenClipOutput(InternalContext* ctx, const char* url, int* streamMap)
+{
+	AVFormatContext* output = NULL;
+	if (avformat_alloc_output_context2(&output, NULL, NULL, url) < 0)
+		return NULL;
+
+	for (unsigned int i = 0; i < ctx->format->nb_streams; i++)
 	{
-		if (streamIndex)
-			*streamIndex = ctx->ctx.playback.selectedAudioStream;
+		if (streamMap[i] < 0)
+			continue;
 
-		// always update original sample rate to support variable sample rate
-		context->audio.originalSampleRate = softwareFrame->sample_rate > 0 ? softwareFrame->sample_rate : 44100;
+		const AVStream* in = ctx->format->streams[i];
+		AVStream* out = avformat_new_stream(output, NULL);
+		if (!out || avcodec_parameters_copy(out->codecpar, in->codecpar) < 0)
+		{
+			avformat_free_context(output);
+			return NULL;
+		}
+		// tag of input container may not be valid in output container
+		out->codecpar->codec_tag = 0;
+		out->time_base = in->time_base;
+		streamMap[i] = out->index;
+	}
 
-		ctx->funcDecodeFrame = &MediaDecoder_NextFrame_Audio;
+	if (!(output->oformat->flags & AVFMT_NOFILE) && avio_open(&output->pb, url, AVIO_FLAG_WRITE) < 0)
+	{
+		avformat_free_context(output);
+		return NULL;
 	}
-	else
+	if (avformat_write_header(output, NULL) < 0)
 	{
-		// should never happen
-		ret = -100;
+		if (!(output->oformat->flags & AVFMT_NOFILE))
+			avio_closep(&output->pb);
+		avformat_free_context(output);
+		return NULL;
 	}
+	return output;
+}
 
-	return ret;
+static void MediaDecoder_CloseClipOutput(AVFormatContext* output)
+{
+	av_write_trailer(output);
+	if (!(output->oformat->flags & AVFMT_NOFILE))
+		avio_closep(&output->pb);
+	avformat_free_context(output);
 }
 
-int MediaDecoder_DecodeFrame(MediaDecoderContext* context)
+/// @brief Hand packet with timestamps relative to start of clip to output file or callback
+/// @return 0 on success, 1 if callback stopped export, -1 on error
+static int MediaDecoder_WriteClipPacket(
+	InternalContext* ctx, const MediaDecoderClipInfo* clip, AVFormatContext* output, int outIndex, AVPacket* packet
+)
 {
-	InternalContext* ctx = (InternalContext*)context;
-	return ctx->funcDecodeFrame(context);
+	const AVStream* in = ctx->format->streams[packet->stream_index];
+	if (output)
+	{
+		av_packet_rescale_ts(packet, in->time_base, output->streams[outIndex]->time_base);
+		packet->stream_index = outIndex;
+		packet->pos = -1;
+		return av_interleaved_write_frame(output, packet) < 0 ? -1 : 0;
+	}
+
+	double timeBase = av_q2d(in->time_base);
+	MediaDecoderPacket out;
+	out.streamIndex = packet->stream_index;
+	out.data = packet->data;
+	out.size = packet->size;
+	out.pts = (packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts) * timeBase;
+	out.dts = (packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts) * timeBase;
+	out.duration = packet->duration * timeBase;
+	out.isKeyframe = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+	return clip->callback(clip->userData, &out) ? 1 : 0;
 }
 
-int MediaDecoder_Seek(MediaDecoderContext* context, double time)
+int64_t MediaDecoder_ExportClip(MediaDecoderContext* context, const MediaDecoderClipInfo* clip)
 {
 	InternalContext* ctx = (InternalContext*)context;
+	if (!clip || (!clip->url && !clip->callback) || ctx->isLive || ctx->isSuspended)
+		return -1;
 
-	for (int si = 0; si < sizeof(context->playback.selectedStreams) / sizeof(*context->playback.selectedStreams); si++)
+	// clip starts at keyframe of video stream, or of audio stream if there is no video
+	MediaDecoderPlaybackInfo* playback = &context->playback;
+	int keyStream = playback->selectedVideoStream != -1 ? (int)playback->selectedVideoStream
+														: (int)playback->selectedAudioStream;
+	if (keyStream < 0)
+		return -1;
+
+	int* streamMap = Allocator_Alloc(sizeof(*streamMap) * ctx->format->nb_streams);
+	if (!streamMap)
+		return -1;
+	for (unsigned int i = 0; i < ctx->format->nb_streams; i++)
+		streamMap[i] = -1;
+	uint32_t pendingCount = 0;
+	for (int i = 0; i < sizeof(playback->selectedStreams) / sizeof(*playback->selectedStreams); i++)
 	{
-		if (context->playback.selectedStreams[si] != -1)
-		{
-			AVStream* stream = ctx->format->streams[context->playback.selectedStreams[si]];
+		if (playback->selectedStreams[i] == -1)
+			continue;
+		streamMap[playback->selectedStreams[i]] = playback->selectedStreams[i];
+		pendingCount++;
+	}
 
-			AVRational timebase = stream->time_base;
-			int64_t shortTime = (int64_t)(0.1 * timebase.den / timebase.num);
-			if (shortTime < 1)
-				shortTime = 1;
+	AVFormatContext* output = NULL;
+	if (!clip->callback)
+	{
+		output = MediaDecoder_OpenClipOutput(ctx, clip->url, streamMap);
+		if (!output)
+		{
+			Allocator_Free(streamMap);
+			return -1;
+		}
+	}
 
-			int64_t ts = (int64_t)(time * timebase.den / timebase.num);
-			int64_t min = ts - shortTime;
-			int64_t max = ts + shortTime;
+	// only demuxer is used, decoders stay untouched but can not continue where they were
+	if (ctx->sequence)
+		SequenceDecoder_Cancel(ctx->sequence);
+	ctx->canContinueDecoding = 0;
+
+	const AVStream* keyStreamInfo = ctx->format->streams[keyStream];
+	int64_t seekTs = llround(clip->startTime / av_q2d(keyStreamInfo->time_base));
+	AVPacket* packet = av_packet_alloc();
+	int ret = packet && av_seek_frame(ctx->format, keyStream, seekTs, AVSEEK_FLAG_BACKWARD) >= 0 ? 0 : -1;
+
+	// times in AV_TIME_BASE, offset is pts of keyframe clip starts with
+	int64_t offset = AV_NOPTS_VALUE;
+	int isFirstGop = 1;
+	int64_t endTime = clip->endTime > clip->startTime ? llround(clip->endTime * AV_TIME_BASE) : INT64_MAX;
+	int64_t count = 0;
+	while (ret == 0 && pendingCount > 0 && av_read_frame(ctx->format, packet) == 0)
+	{
+		int index = packet->stream_index;
+		const AVStream* in = ctx->format->streams[index];
+		int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+		if (streamMap[index] < 0 || pts == AV_NOPTS_VALUE)
+		{
+			av_packet_unref(packet);
+			continue;
+		}
 
-			int ret = avformat_seek_file(ctx->format, -1, INT64_MIN, ts, INT64_MAX, 0);
-			if (ret < 0)
+		int64_t time = av_rescale_q(pts, in->time_base, AV_TIME_BASE_Q);
+		int64_t dts = packet->dts != AV_NOPTS_VALUE ? av_rescale_q(packet->dts, in->time_base, AV_TIME_BASE_Q) : time;
+		if (offset == AV_NOPTS_VALUE)
+		{
+			// packets before first keyframe could not be decoded
+			if (index != keyStream || !(packet->flags & AV_PKT_FLAG_KEY))
 			{
-				char* str = av_err2str(ret);
-				return -1;
+				av_packet_unref(packet);
+				continue;
 			}
-			break;
+			offset = time;
+		}
+		else if (index == keyStream && (packet->flags & AV_PKT_FLAG_KEY))
+		{
+			isFirstGop = 0;
 		}
-	}
-
-	if (MediaDecoder_NextFrame(context, NULL))
-		return -1;
-	if (MediaDecoder_NextFrame(context, NULL))
-		return -1;
-
-	context->playback.position = time;
-	return 0;
-}
-
-int MediaDecoder_Close(MediaDecoderContext** context)
-{
-	if (!context || !*context)
-		return 0;
 
-	InternalContext* ctx = (InternalContext*)*context;
-	if (ctx->ctx.video.frameBuffer)
-		free(ctx->ctx.video.frameBuffer);
-	if (ctx->ctx.audio.frameBuffer)
-		free(ctx->ctx.audio.frameBuffer);
-	ImageResizer_ReleaseContext(&ctx->resizer);
-	av_packet_free(&ctx->packet);
-#ifndef DISABLE_HARDWARE_ACCELERATION
-	av_frame_free(&ctx->frame2);
-#endif
-	av_frame_free(&ctx->frame);
-	if (ctx->codecVideo)
-		avcodec_free_context(&ctx->codecVideo);
-	if (ctx->codecAudio)
-		avcodec_free_context(&ctx->codecAudio);
-	avformat_free_context(ctx->format);
-	free(*context);
-	*context = NULL;
-	return 0;
-}
+		if (dts >= endTime)
+		{
+			// packets are read in decoding order, so all following packets of stream are after end
+			streamMap[index] = -1;
+			pendingCount--;
+			av_packet_unref(packet);
+			continue;
+		}
+		// packets shown after end are kept, frames shown before end may refer to them. only leading pictures of
+		// first GOP, which refer to frames before clip, and other streams before clip are dropped
+		if (time < offset && (index != keyStream || isFirstGop))
+		{
+			av_packet_unref(packet);
+			continue;
+		}
 
-int MediaDecoder_TakeAudioSamples(MediaDecoderContext* context, float* buffer, uint32_t sampleCountPerChannel)
-{
-	// int readSamples;
-	// if (context->audio.sampleCountPerChannel >= sampleCountPerChannel)
-	//	readSamples = sampleCountPerChannel * context->audio.channelCount;
-	// else
-	//	readSamples = context->audio.sampleCountPerChannel * context->audio.channelCount;
+		int64_t shift = av_rescale_q(offset, AV_TIME_BASE_Q, in->time_base);
+		if (packet->pts != AV_NOPTS_VALUE)
+			packet->pts -= shift;
+		if (packet->dts != AV_NOPTS_VALUE)
+			packet->dts -= shift;
 
-	// if (readSamples)
-	//{
-	//	memcpy(buffer, context->audio.frameBuffer, sizeof(float) * readSamples);
-	//	size_t diff = (context->audio.sampleCountPerChannel * (size_t)context->audio.channelCount) - readSamples;
-	//	memmove(context->audio.frameBuffer, context->audio.frameBuffer + sizeof(float) * readSamples, diff);
-	//	context->audio.sampleCountPerChannel -= (readSamples / context->audio.channelCount);
-	// }
+		ret = MediaDecoder_WriteClipPacket(ctx, clip, output, streamMap[index], packet);
+		if (ret >= 0)
+			count++;
+		av_packet_unref(packet);
+	}
 
-	// return readSamples;
-	return 0;
+	if (output)
+		MediaDecoder_CloseClipOutput(output);
+	av_packet_free(&packet);
+	Allocator_Free(streamMap);
+	return ret < 0 ? -1 : count;
 }
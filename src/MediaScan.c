@@ -0,0 +1,253 @@
+#include "MediaDecoder.h"
+
+#include "Allocator.h"
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <memory.h>
+
+#define DEFAULT_INTERVAL 1.0
+// broken timestamps must not make bitrate graph grow without limit, later packets are added to last interval
+#define MAX_INTERVAL_COUNT (1u << 20)
+#define SIZE_HISTOGRAM_BINS (sizeof(((MediaDecoderScanStream*)0)->sizeHistogram) / sizeof(uint32_t))
+
+typedef struct
+{
+	// range of presentation timestamps in time base of stream
+	int64_t startPts;
+	int64_t endPts;
+	uint32_t keyframeCapacity;
+	uint32_t intervalCapacity;
+	// packets since last keyframe
+	uint32_t gopLength;
+} ScanState;
+
+static MediaDecoderStreamType Scan_GetStreamType(enum AVMediaType type)
+{
+	switch (type)
+	{
+	case AVMEDIA_TYPE_VIDEO:
+		return VIDEO_STREAM;
+	case AVMEDIA_TYPE_AUDIO:
+		return AUDIO_STREAM;
+	case AVMEDIA_TYPE_SUBTITLE:
+		return SUBTITLE_STREAM;
+	default:
+		return UNKNOWN_STREAM;
+	}
+}
+
+static void Scan_EndGop(MediaDecoderScanStream* stream, ScanState* state)
+{
+	if (stream->keyframeCount > 0)
+		stream->keyframes[stream->keyframeCount - 1].gopLength = state->gopLength;
+	if (state->gopLength > stream->maxGopLength)
+		stream->maxGopLength = state->gopLength;
+	state->gopLength = 0;
+}
+
+static int Scan_AddKeyframe(MediaDecoderScanStream* stream, ScanState* state, const AVPacket* packet, double time)
+{
+	Scan_EndGop(stream, state);
+
+	if (stream->keyframeCount == state->keyframeCapacity)
+	{
+		uint32_t capacity = state->keyframeCapacity ? state->keyframeCapacity * 2 : 64;
+		MediaDecoderScanKeyframe* tmp = Allocator_Realloc(stream->keyframes, sizeof(*tmp) * capacity);
+		if (!tmp)
+			return -1;
+		stream->keyframes = tmp;
+		state->keyframeCapacity = capacity;
+	}
+
+	MediaDecoderScanKeyframe* keyframe = &stream->keyframes[stream->keyframeCount++];
+	keyframe->time = time;
+	keyframe->position = packet->pos;
+	keyframe->gopLength = 0;
+	return 0;
+}
+
+static int Scan_AddBytes(MediaDecoderScanStream* stream, ScanState* state, uint32_t index, int size)
+{
+	if (index >= state->intervalCapacity)
+	{
+		// allocator always moves contents, so capacity grows geometrically. intervals without packets stay 0
+		uint32_t capacity = state->intervalCapacity ? state->intervalCapacity : 64;
+		while (capacity <= index)
+			capacity = capacity < MAX_INTERVAL_COUNT / 2 ? capacity * 2 : MAX_INTERVAL_COUNT;
+		uint64_t* tmp = Allocator_Realloc(stream->bytesPerInterval, sizeof(*tmp) * capacity);
+		if (!tmp)
+			return -1;
+		memset(tmp + state->intervalCapacity, 0, sizeof(*tmp) * (capacity - state->intervalCapacity));
+		stream->bytesPerInterval = tmp;
+		state->intervalCapacity = capacity;
+	}
+	if (index >= stream->intervalCount)
+		stream->intervalCount = index + 1;
+	stream->bytesPerInterval[index] += size;
+	return 0;
+}
+
+static int Scan_AddPacket(
+	MediaDecoderScanInfo* scan, ScanState* state, const AVFormatContext* format, const AVPacket* packet, double start
+)
+{
+	const AVStream* avStream = format->streams[packet->stream_index];
+	MediaDecoderScanStream* stream = &scan->streams[packet->stream_index];
+	double timeBase = av_q2d(avStream->time_base);
+
+	stream->packetCount++;
+	stream->byteCount += packet->size;
+	if (stream->type == VIDEO_STREAM)
+		state->gopLength++;
+
+	uint32_t bin = 0;
+	while (bin + 1 < SIZE_HISTOGRAM_BINS && (packet->size >> (bin + 1)) > 0)
+		bin++;
+	stream->sizeHistogram[bin]++;
+
+	// packets are read in decoding order, so pts of later packets may be smaller
+	int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+	if (pts != AV_NOPTS_VALUE)
+	{
+		int64_t end = pts + (packet->duration > 0 ? packet->duration : 0);
+		if (state->startPts == AV_NOPTS_VALUE || pts < state->startPts)
+			state->startPts = pts;
+		if (state->endPts == AV_NOPTS_VALUE || end > state->endPts)
+			state->endPts = end;
+	}
+
+	if ((packet->flags & AV_PKT_FLAG_KEY) && stream->type == VIDEO_STREAM &&
+		Scan_AddKeyframe(stream, state, packet, pts != AV_NOPTS_VALUE ? pts * timeBase : 0.0))
+	{
+		return -1;
+	}
+
+	// bitrate is accounted at decoding time, which increases steadily unlike presentation time
+	int64_t dts = packet->dts != AV_NOPTS_VALUE ? packet->dts : pts;
+	double time = dts != AV_NOPTS_VALUE ? dts * timeBase - start : 0.0;
+	double index = time > 0.0 ? time / scan->interval : 0.0;
+	return Scan_AddBytes(
+		stream, state, index < MAX_INTERVAL_COUNT ? (uint32_t)index : MAX_INTERVAL_COUNT - 1, packet->size
+	);
+}
+
+/// @brief Add streams that demuxer found since last call, some formats only find streams while packets are read
+static int Scan_AddStreams(MediaDecoderScanInfo* scan, ScanState** states, const AVFormatContext* format)
+{
+	uint32_t count = format->nb_streams;
+	if (count <= scan->streamCount)
+		return 0;
+
+	MediaDecoderScanStream* streams = Allocator_Realloc(scan->streams, sizeof(*streams) * count);
+	if (!streams)
+		return -1;
+	scan->streams = streams;
+	ScanState* tmp = Allocator_Realloc(*states, sizeof(*tmp) * count);
+	if (!tmp)
+		return -1;
+	*states = tmp;
+
+	memset(streams + scan->streamCount, 0, sizeof(*streams) * (count - scan->streamCount));
+	memset(tmp + scan->streamCount, 0, sizeof(*tmp) * (count - scan->streamCount));
+	for (uint32_t i = scan->streamCount; i < count; i++)
+	{
+		streams[i].type = Scan_GetStreamType(format->streams[i]->codecpar->codec_type);
+		tmp[i].startPts = tmp[i].endPts = AV_NOPTS_VALUE;
+	}
+	scan->streamCount = count;
+	return 0;
+}
+
+static int Scan_ReadPackets(MediaDecoderScanInfo* scan, ScanState** states, AVFormatContext* format)
+{
+	AVPacket* packet = av_packet_alloc();
+	if (!packet)
+		return -1;
+
+	double start = format->start_time != AV_NOPTS_VALUE ? (double)format->start_time / AV_TIME_BASE : 0.0;
+
+	// packets are never sent to a decoder, so scanning runs at the speed of reading the file
+	int ret = 0;
+	while (ret == 0 && av_read_frame(format, packet) == 0)
+	{
+		if (packet->stream_index >= 0 && (uint32_t)packet->stream_index >= scan->streamCount)
+			ret = Scan_AddStreams(scan, states, format);
+		if (ret == 0 && packet->stream_index >= 0 && (uint32_t)packet->stream_index < scan->streamCount)
+			ret = Scan_AddPacket(scan, &(*states)[packet->stream_index], format, packet, start);
+		av_packet_unref(packet);
+	}
+
+	av_packet_free(&packet);
+	return ret;
+}
+
+static void Scan_Finish(MediaDecoderScanInfo* scan, ScanState* states, const AVFormatContext* format)
+{
+	double startTime = 0.0;
+	double endTime = 0.0;
+	int hasTime = 0;
+	for (uint32_t i = 0; i < scan->streamCount; i++)
+	{
+		MediaDecoderScanStream* stream = &scan->streams[i];
+		if (stream->type == VIDEO_STREAM)
+			Scan_EndGop(stream, &states[i]);
+		if (states[i].startPts == AV_NOPTS_VALUE)
+			continue;
+
+		double timeBase = av_q2d(format->streams[i]->time_base);
+		stream->startTime = states[i].startPts * timeBase;
+		stream->endTime = states[i].endPts * timeBase;
+		if (!hasTime || stream->startTime < startTime)
+			startTime = stream->startTime;
+		if (!hasTime || stream->endTime > endTime)
+			endTime = stream->endTime;
+		hasTime = 1;
+	}
+	scan->duration = endTime - startTime;
+}
+
+MediaDecoderScanInfo* MediaDecoder_Scan(const char* url, double interval)
+{
+	AVFormatContext* format = NULL;
+	if (avformat_open_input(&format, url, NULL, NULL) < 0)
+		return NULL;
+
+	MediaDecoderScanInfo* scan = Allocator_Calloc(1, sizeof(*scan));
+	ScanState* states = NULL;
+	if (!scan || Scan_AddStreams(scan, &states, format))
+	{
+		Allocator_Free(states);
+		MediaDecoder_ReleaseScan(&scan);
+		avformat_close_input(&format);
+		return NULL;
+	}
+
+	scan->interval = interval > 0.0 ? interval : DEFAULT_INTERVAL;
+	int ret = Scan_ReadPackets(scan, &states, format);
+	if (ret == 0)
+		Scan_Finish(scan, states, format);
+
+	Allocator_Free(states);
+	avformat_close_input(&format);
+	if (ret)
+		MediaDecoder_ReleaseScan(&scan);
+	return scan;
+}
+
+void MediaDecoder_ReleaseScan(MediaDecoderScanInfo** scan)
+{
+	if (!scan || !*scan)
+		return;
+
+	if ((*scan)->streams)
+	{
+		for (uint32_t i = 0; i < (*scan)->streamCount; i++)
+		{
+			Allocator_Free((*scan)->streams[i].keyframes);
+			Allocator_Free((*scan)->streams[i].bytesPerInterval);
+		}
+		Allocator_Free((*scan)->streams);
+	}
+	Allocator_Free(*scan);
+	*scan = NULL;
+}
@@ -0,0 +1,525 @@
+#include "MediaDecoder.h"
+
+#include "Allocator.h"
+#include "ImageResizer.h"
+#include "Internal.h"
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/cpu.h>
+#include <libavutil/imgutils.h>
+#include <stdatomic.h>
+#include <threads.h>
+
+// more ranges than threads, so that threads that finish early can pick up remaining work
+#define RANGES_PER_THREAD 4
+#define DEFAULT_MEMORY_BUDGET (512ull * 1024 * 1024)
+
+typedef struct ParallelFrame
+{
+	uint8_t* buffer;
+	double time;
+	struct ParallelFrame* next;
+} ParallelFrame;
+
+typedef struct
+{
+	// frames with pts in [startPts, endPts) belong to this range
+	int64_t startPts;
+	int64_t endPts;
+	int64_t seekDts;
+
+	ParallelFrame* first;
+	ParallelFrame* last;
+	int isDone;
+} ParallelRange;
+
+typedef struct
+{
+	const char* url;
+	const MediaDecoderParallelInfo* info;
+	int streamIndex;
+	uint32_t width;
+	uint32_t height;
+	int bytesPerFrame;
+	uint64_t memoryBudget;
+	// bytes of frames that are converted or queued in any range, and not yet delivered
+	uint64_t queuedBytes;
+
+	ParallelRange* ranges;
+	uint32_t rangeCount;
+	uint32_t nextRange;
+	uint32_t currentRange;
+	uint32_t threadCount;
+	// also read without lock by workers, to stop decoding early
+	atomic_int isAborted;
+
+	mtx_t lock;
+	cnd_t frameReady;
+	cnd_t frameTaken;
+} ParallelContext;
+
+typedef struct
+{
+	int64_t pts;
+	int64_t dts;
+} Keyframe;
+
+static int Parallel_FindKeyframes(AVFormatContext* format, int streamIndex, Keyframe** keyframes, uint32_t* count)
+{
+	// only packets are read, which is much faster than decoding
+	AVPacket* packet = av_packet_alloc();
+	if (!packet)
+		return -1;
+
+	uint32_t capacity = 0;
+	*keyframes = NULL;
+	*count = 0;
+	while (av_read_frame(format, packet) == 0)
+	{
+		if (packet->stream_index == streamIndex && (packet->flags & AV_PKT_FLAG_KEY))
+		{
+			if (*count == capacity)
+			{
+				capacity = capacity ? capacity * 2 : 64;
+				Keyframe* tmp = Allocator_Realloc(*keyframes, sizeof(*tmp) * capacity);
+				if (!tmp)
+				{
+					av_packet_unref(packet);
+					av_packet_free(&packet);
+					return -1;
+				}
+				*keyframes = tmp;
+			}
+
+			Keyframe* key = &(*keyframes)[(*count)++];
+			key->dts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+			key->pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+		}
+		av_packet_unref(packet);
+	}
+
+	av_packet_free(&packet);
+	return 0;
+}
+
+static int Parallel_CreateRanges(ParallelContext* ctx, const Keyframe* keyframes, uint32_t keyframeCount)
+{
+	uint32_t rangeCount = ctx->threadCount * RANGES_PER_THREAD;
+	if (rangeCount > keyframeCount)
+		rangeCount = keyframeCount;
+	if (rangeCount < 1)
+		rangeCount = 1;
+
+	ctx->ranges = Allocator_Calloc(rangeCount, sizeof(*ctx->ranges));
+	if (!ctx->ranges)
+		return -1;
+	ctx->rangeCount = rangeCount;
+
+	for (uint32_t i = 0; i < rangeCount; i++)
+	{
+		// split keyframes as evenly as possible, first range also covers anything before first keyframe
+		uint32_t first = (uint32_t)((uint64_t)keyframeCount * i / rangeCount);
+		uint32_t end = (uint32_t)((uint64_t)keyframeCount * (i + 1) / rangeCount);
+
+		ParallelRange* range = &ctx->ranges[i];
+		range->startPts = i == 0 || !keyframeCount ? INT64_MIN : keyframes[first].pts;
+		range->endPts = end >= keyframeCount ? INT64_MAX : keyframes[end].pts;
+		range->seekDts = keyframeCount ? keyframes[first].dts : 0;
+	}
+
+	return 0;
+}
+
+/// @brief Wait until memory budget has room for one more frame, and count it as queued
+/// @return -1 if decoding was aborted while waiting
+static int Parallel_ReserveFrame(ParallelContext* ctx, ParallelRange* range)
+{
+	mtx_lock(&ctx->lock);
+
+	// budget is shared by all ranges. range that is being delivered may always add a frame once its queue is
+	// empty, otherwise it could wait for frames of later ranges that are only delivered after it
+	while (!ctx->isAborted && ctx->queuedBytes + ctx->bytesPerFrame > ctx->memoryBudget &&
+		   (range != &ctx->ranges[ctx->currentRange] || range->first))
+	{
+		cnd_wait(&ctx->frameTaken, &ctx->lock);
+	}
+
+	int ret = ctx->isAborted ? -1 : 0;
+	if (ret == 0)
+		ctx->queuedBytes += ctx->bytesPerFrame;
+	mtx_unlock(&ctx->lock);
+	return ret;
+}
+
+static void Parallel_CancelFrame(ParallelContext* ctx)
+{
+	mtx_lock(&ctx->lock);
+	ctx->queuedBytes -= ctx->bytesPerFrame;
+	cnd_broadcast(&ctx->frameTaken);
+	mtx_unlock(&ctx->lock);
+}
+
+static int Parallel_AddFrame(ParallelContext* ctx, ParallelRange* range, uint8_t* buffer, double time)
+{
+	ParallelFrame* frame = Allocator_Alloc(sizeof(*frame));
+	if (!frame)
+		return -1;
+	frame->buffer = buffer;
+	frame->time = time;
+	frame->next = NULL;
+
+	mtx_lock(&ctx->lock);
+	if (range->last)
+		range->last->next = frame;
+	else
+		range->first = frame;
+	range->last = frame;
+
+	cnd_broadcast(&ctx->frameReady);
+	mtx_unlock(&ctx->lock);
+	return 0;
+}
+
+static int Parallel_ConvertFrame(
+	ParallelContext* ctx, ImageResizerContext* resizer, ParallelRange* range, const AVFrame* frame, double time
+)
+{
+	const MediaDecoderParallelInfo* info = ctx->info;
+	if (Parallel_ReserveFrame(ctx, range))
+		return 0;
+
+	uint8_t* buffer = Allocator_Alloc(ctx->bytesPerFrame);
+	if (!buffer)
+	{
+		Parallel_CancelFrame(ctx);
+		return -1;
+	}
+
+	MediaDecoderPlaneInfo planes[4];
+	int planeCount = FillPlaneInfo(info->decodedPixelFormat, ctx->width, ctx->height, buffer, planes);
+
+	uint8_t* outImageData[] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+	int outImageLineSize[] = {0, 0, 0, 0, 0, 0, 0, 0};
+	for (int i = 0; i < planeCount; i++)
+	{
+		outImageData[i] = planes[i].data;
+		outImageLineSize[i] = planes[i].stride;
+	}
+
+	ImageResizer_SetQuality(resizer, info->scaleQuality);
+	bool isValid = ImageResizer_SetParameters(
+		resizer, frame->width, frame->height, frame->format | 0x10000, ctx->width, ctx->height,
+		info->decodedPixelFormat
+	);
+	if (planeCount < 1 || !isValid)
+	{
+		Allocator_Free(buffer);
+		Parallel_CancelFrame(ctx);
+		return -1;
+	}
+	ImageResizer_Resize(resizer, (const uint8_t**)frame->data, frame->linesize, outImageData, outImageLineSize);
+
+	if (Parallel_AddFrame(ctx, range, buffer, time))
+	{
+		Allocator_Free(buffer);
+		Parallel_CancelFrame(ctx);
+		return -1;
+	}
+	return 0;
+}
+
+static int Parallel_DecodeRange(
+	ParallelContext* ctx, AVFormatContext* format, AVCodecContext* codec, ImageResizerContext* resizer,
+	AVPacket* packet, AVFrame* frame, ParallelRange* range
+)
+{
+	AVStream* stream = format->streams[ctx->streamIndex];
+
+	// first range is always the first one a thread takes, so its demuxer is still at start of file
+	if (range->startPts != INT64_MIN)
+	{
+		if (av_seek_frame(format, ctx->streamIndex, range->seekDts, AVSEEK_FLAG_BACKWARD) < 0)
+			return -1;
+		avcodec_flush_buffers(codec);
+	}
+
+	int isDraining = 0;
+	while (!ctx->isAborted)
+	{
+		int ret = avcodec_receive_frame(codec, frame);
+		if (ret == 0)
+		{
+			int64_t pts = frame->best_effort_timestamp;
+
+			// leading frames belong to previous range, which decodes them from its own keyframe
+			if (pts != AV_NOPTS_VALUE && pts < range->startPts)
+			{
+				av_frame_unref(frame);
+				continue;
+			}
+
+			// frames are returned in presentation order, so everything of this range was already returned
+			if (pts != AV_NOPTS_VALUE && pts >= range->endPts)
+			{
+				av_frame_unref(frame);
+				return 0;
+			}
+
+			double time = pts != AV_NOPTS_VALUE ? pts * av_q2d(stream->time_base) : 0.0;
+			ret = Parallel_ConvertFrame(ctx, resizer, range, frame, time);
+			av_frame_unref(frame);
+			if (ret)
+				return -1;
+			continue;
+		}
+
+		if (ret == AVERROR_EOF)
+			return 0;
+		if (ret != AVERROR(EAGAIN))
+			return -1;
+
+		if (av_read_frame(format, packet) < 0)
+		{
+			if (isDraining)
+				return 0;
+
+			// get remaining frames out of decoder
+			isDraining = 1;
+			avcodec_send_packet(codec, NULL);
+			continue;
+		}
+
+		if (packet->stream_index == ctx->streamIndex)
+			avcodec_send_packet(codec, packet);
+		av_packet_unref(packet);
+	}
+
+	return 0;
+}
+
+static int Parallel_Worker(void* arg)
+{
+	ParallelContext* ctx = (ParallelContext*)arg;
+
+	// every thread has its own demuxer and decoder, so that ranges are completely independent
+	AVFormatContext* format = NULL;
+	AVCodecContext* codec = NULL;
+	AVPacket* packet = av_packet_alloc();
+	AVFrame* frame = av_frame_alloc();
+	ImageResizerContext* resizer = ImageResizer_CreateContext();
+	int ret = -1;
+
+	if (packet && frame && resizer && avformat_open_input(&format, ctx->url, NULL, NULL) == 0)
+	{
+		for (unsigned int i = 0; i < format->nb_streams; i++)
+		{
+			if (i != (unsigned int)ctx->streamIndex)
+				format->streams[i]->discard = AVDISCARD_ALL;
+		}
+
+		// one thread per decoder, parallelism comes from decoding many ranges at once
+		const AVCodecParameters* codecParams = format->streams[ctx->streamIndex]->codecpar;
+		codec = CreateDecoder(
+			codecParams, 1, GetPreviewLevel(codecParams->width, codecParams->height, ctx->width, ctx->height)
+		);
+		ret = codec ? 0 : -1;
+	}
+
+	while (ret == 0)
+	{
+		mtx_lock(&ctx->lock);
+		uint32_t index = ctx->nextRange;
+		if (index < ctx->rangeCount && !ctx->isAborted)
+			ctx->nextRange++;
+		mtx_unlock(&ctx->lock);
+
+		if (index >= ctx->rangeCount || ctx->isAborted)
+			break;
+
+		ParallelRange* range = &ctx->ranges[index];
+		ret = Parallel_DecodeRange(ctx, format, codec, resizer, packet, frame, range);
+
+		mtx_lock(&ctx->lock);
+		range->isDone = 1;
+		if (ret)
+			ctx->isAborted = 1;
+		cnd_broadcast(&ctx->frameReady);
+		mtx_unlock(&ctx->lock);
+	}
+
+	if (ret)
+	{
+		mtx_lock(&ctx->lock);
+		ctx->isAborted = 1;
+		cnd_broadcast(&ctx->frameReady);
+		cnd_broadcast(&ctx->frameTaken);
+		mtx_unlock(&ctx->lock);
+	}
+
+	if (resizer)
+		ImageResizer_ReleaseContext(&resizer);
+	av_frame_free(&frame);
+	av_packet_free(&packet);
+	avcodec_free_context(&codec);
+	avformat_close_input(&format);
+	return ret;
+}
+
+static int64_t Parallel_Deliver(ParallelContext* ctx)
+{
+	const MediaDecoderParallelInfo* info = ctx->info;
+	MediaDecoderVideoInfo video = {0};
+	video.originalWidth = video.decodedWidth = ctx->width;
+	video.originalHeight = video.decodedHeight = ctx->height;
+	video.decodedPixelFormat = info->decodedPixelFormat;
+	video.scaleQuality = info->scaleQuality;
+	video.bytesPerFrame = ctx->bytesPerFrame;
+
+	int64_t delivered = 0;
+	mtx_lock(&ctx->lock);
+	while (ctx->currentRange < ctx->rangeCount)
+	{
+		ParallelRange* range = &ctx->ranges[ctx->currentRange];
+		while (!range->first && !range->isDone && !ctx->isAborted)
+			cnd_wait(&ctx->frameReady, &ctx->lock);
+
+		if (ctx->isAborted)
+			break;
+
+		if (!range->first)
+		{
+			// range is complete, following range may now grow without limit
+			ctx->currentRange++;
+			cnd_broadcast(&ctx->frameTaken);
+			continue;
+		}
+
+		ParallelFrame* frame = range->first;
+		range->first = frame->next;
+		if (!range->first)
+			range->last = NULL;
+		ctx->queuedBytes -= ctx->bytesPerFrame;
+		cnd_broadcast(&ctx->frameTaken);
+		mtx_unlock(&ctx->lock);
+
+		video.frameBuffer = frame->buffer;
+		video.planeCount =
+			FillPlaneInfo(video.decodedPixelFormat, ctx->width, ctx->height, frame->buffer, video.planes);
+		int stop = info->callback(info->userData, &video, frame->time);
+		Allocator_Free(frame->buffer);
+		Allocator_Free(frame);
+		delivered++;
+
+		mtx_lock(&ctx->lock);
+		if (stop)
+		{
+			ctx->isAborted = 1;
+			cnd_broadcast(&ctx->frameTaken);
+			break;
+		}
+	}
+	mtx_unlock(&ctx->lock);
+
+	return delivered;
+}
+
+int64_t MediaDecoder_DecodeParallel(const char* url, const MediaDecoderParallelInfo* info)
+{
+	if (!url || !info || !info->callback)
+		return -1;
+
+	ParallelContext ctx = {0};
+	ctx.url = url;
+	ctx.info = info;
+	ctx.threadCount = info->threadCount ? info->threadCount : av_cpu_count();
+	if (ctx.threadCount < 1)
+		ctx.threadCount = 1;
+
+	AVFormatContext* format = NULL;
+	if (avformat_open_input(&format, url, NULL, NULL) < 0)
+		return -1;
+
+	ctx.streamIndex = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+	if (ctx.streamIndex < 0)
+	{
+		avformat_close_input(&format);
+		return -1;
+	}
+
+	for (unsigned int i = 0; i < format->nb_streams; i++)
+	{
+		if (i != (unsigned int)ctx.streamIndex)
+			format->streams[i]->discard = AVDISCARD_ALL;
+	}
+
+	const AVCodecParameters* codecParams = format->streams[ctx.streamIndex]->codecpar;
+	ctx.width = info->decodedWidth ? info->decodedWidth : (uint32_t)codecParams->width;
+	ctx.height = info->decodedHeight ? info->decodedHeight : (uint32_t)codecParams->height;
+	ctx.bytesPerFrame = av_image_get_buffer_size(MapPixelFormat(info->decodedPixelFormat), ctx.width, ctx.height, 1);
+
+	Keyframe* keyframes = NULL;
+	uint32_t keyframeCount = 0;
+	int ret = ctx.bytesPerFrame > 0 ? Parallel_FindKeyframes(format, ctx.streamIndex, &keyframes, &keyframeCount) : -1;
+	avformat_close_input(&format);
+
+	if (ret == 0)
+		ret = Parallel_CreateRanges(&ctx, keyframes, keyframeCount);
+	Allocator_Free(keyframes);
+	if (ret)
+		return -1;
+
+	ctx.memoryBudget = info->memoryBudget ? info->memoryBudget : DEFAULT_MEMORY_BUDGET;
+
+	mtx_init(&ctx.lock, mtx_plain);
+	cnd_init(&ctx.frameReady);
+	cnd_init(&ctx.frameTaken);
+
+	thrd_t* threads = Allocator_Alloc(sizeof(*threads) * ctx.threadCount);
+	uint32_t startedThreads = 0;
+	if (threads)
+	{
+		for (; startedThreads < ctx.threadCount; startedThreads++)
+		{
+			if (thrd_create(&threads[startedThreads], Parallel_Worker, &ctx) != thrd_success)
+				break;
+		}
+	}
+
+	int64_t delivered = -1;
+	if (startedThreads > 0)
+		delivered = Parallel_Deliver(&ctx);
+
+	// wake up workers that wait for their frames to be taken
+	mtx_lock(&ctx.lock);
+	if (ctx.currentRange < ctx.rangeCount)
+		ctx.isAborted = 1;
+	cnd_broadcast(&ctx.frameTaken);
+	mtx_unlock(&ctx.lock);
+
+	int failed = startedThreads == 0;
+	for (uint32_t i = 0; i < startedThreads; i++)
+	{
+		int result = 0;
+		thrd_join(threads[i], &result);
+		failed |= result != 0;
+	}
+	Allocator_Free(threads);
+
+	for (uint32_t i = 0; i < ctx.rangeCount; i++)
+	{
+		while (ctx.ranges[i].first)
+		{
+			ParallelFrame* frame = ctx.ranges[i].first;
+			ctx.ranges[i].first = frame->next;
+			Allocator_Free(frame->buffer);
+			Allocator_Free(frame);
+		}
+	}
+	Allocator_Free(ctx.ranges);
+
+	cnd_destroy(&ctx.frameTaken);
+	cnd_destroy(&ctx.frameReady);
+	mtx_destroy(&ctx.lock);
+
+	return failed ? -1 : delivered;
+}
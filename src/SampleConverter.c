@@ -0,0 +1,398 @@
+#include "SampleConverter.h"
+
+#include <libavutil/common.h>
+#include <math.h>
+#include <stddef.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SAMPLE_CONVERTER_SSE2
+#include <emmintrin.h>
+#endif
+
+// conversions match the ones of swresample, so that output does not change when it is bypassed
+#define CONVERT_U8_U8(x) (x)
+#define CONVERT_U8_S16(x) (int16_t)(((int)(x) - 0x80) * (1 << 8))
+#define CONVERT_U8_S32(x) (int32_t)(((int32_t)(x) - 0x80) * (1 << 24))
+#define CONVERT_U8_FLT(x) (((int)(x) - 0x80) * (1.0f / (1 << 7)))
+#define CONVERT_U8_DBL(x) (((int)(x) - 0x80) * (1.0 / (1 << 7)))
+#define CONVERT_S16_U8(x) (uint8_t)(((x) >> 8) + 0x80)
+#define CONVERT_S16_S16(x) (x)
+#define CONVERT_S16_S32(x) (int32_t)((x) * (1 << 16))
+#define CONVERT_S16_FLT(x) ((x) * (1.0f / (1 << 15)))
+#define CONVERT_S16_DBL(x) ((x) * (1.0 / (1 << 15)))
+#define CONVERT_S32_U8(x) (uint8_t)(((x) >> 24) + 0x80)
+#define CONVERT_S32_S16(x) (int16_t)((x) >> 16)
+#define CONVERT_S32_S32(x) (x)
+#define CONVERT_S32_FLT(x) ((x) * (1.0f / (1U << 31)))
+#define CONVERT_S32_DBL(x) ((x) * (1.0 / (1U << 31)))
+#define CONVERT_FLT_U8(x) av_clip_uint8(lrintf((x) * (1 << 7)) + 0x80)
+#define CONVERT_FLT_S16(x) av_clip_int16(lrintf((x) * (1 << 15)))
+#define CONVERT_FLT_S32(x) av_clipl_int32(llrintf((x) * (1U << 31)))
+#define CONVERT_FLT_FLT(x) (x)
+#define CONVERT_FLT_DBL(x) (double)(x)
+#define CONVERT_DBL_U8(x) av_clip_uint8(lrint((x) * (1 << 7)) + 0x80)
+#define CONVERT_DBL_S16(x) av_clip_int16(lrint((x) * (1 << 15)))
+#define CONVERT_DBL_S32(x) av_clipl_int32(llrint((x) * (1U << 31)))
+#define CONVERT_DBL_FLT(x) (float)(x)
+#define CONVERT_DBL_DBL(x) (x)
+
+#define TYPE_U8 uint8_t
+#define TYPE_S16 int16_t
+#define TYPE_S32 int32_t
+#define TYPE_FLT float
+#define TYPE_DBL double
+
+// contiguous samples, used for packed to packed and for each plane of planar to planar
+#define SAMPLE_CONVERTER_RUN(IN, OUT)                                                                              \
+	static void SampleConverter_Run_##IN##_##OUT(const TYPE_##IN* restrict in, TYPE_##OUT* restrict out, size_t count) \
+	{                                                                                                              \
+		for (size_t i = 0; i < count; i++)                                                                         \
+			out[i] = CONVERT_##IN##_##OUT(in[i]);                                                                  \
+	}
+
+// planar stereo to packed stereo, which is what most decoders output and most callers want
+#define SAMPLE_CONVERTER_INTERLEAVE2(IN, OUT)                                                                      \
+	static void SampleConverter_Interleave2_##IN##_##OUT(                                                          \
+		const TYPE_##IN* restrict left, const TYPE_##IN* restrict right, TYPE_##OUT* restrict out, size_t count    \
+	)                                                                                                              \
+	{                                                                                                              \
+		for (size_t i = 0; i < count; i++)                                                                         \
+		{                                                                                                          \
+			out[2 * i] = CONVERT_##IN##_##OUT(left[i]);                                                            \
+			out[2 * i + 1] = CONVERT_##IN##_##OUT(right[i]);                                                       \
+		}                                                                                                          \
+	}
+
+// planar with any other channel count to packed
+#define SAMPLE_CONVERTER_INTERLEAVEN(IN, OUT)                                                                      \
+	static void SampleConverter_InterleaveN_##IN##_##OUT(                                                          \
+		const uint8_t* const* in, int inOffset, TYPE_##OUT* restrict out, size_t count, int channelCount           \
+	)                                                                                                              \
+	{                                                                                                              \
+		for (int c = 0; c < channelCount; c++)                                                                     \
+		{                                                                                                          \
+			const TYPE_##IN* src = (const TYPE_##IN*)in[c] + inOffset;                                             \
+			for (size_t i = 0; i < count; i++)                                                                     \
+				out[i * channelCount + c] = CONVERT_##IN##_##OUT(src[i]);                                          \
+		}                                                                                                          \
+	}
+
+#define SAMPLE_CONVERTER_LAYOUTS(IN, OUT)                                                                          \
+	static void SampleConverter_PackedToPacked_##IN##_##OUT(                                                       \
+		const uint8_t* const* in, int inOffset, uint8_t* const* out, int outOffset, int count, int channelCount     \
+	)                                                                                                              \
+	{                                                                                                              \
+		SampleConverter_Run_##IN##_##OUT(                                                                          \
+			(const TYPE_##IN*)in[0] + (size_t)inOffset * channelCount,                                             \
+			(TYPE_##OUT*)out[0] + (size_t)outOffset * channelCount, (size_t)count * channelCount                   \
+		);                                                                                                         \
+	}                                                                                                              \
+                                                                                                                   \
+	static void SampleConverter_PlanarToPlanar_##IN##_##OUT(                                                       \
+		const uint8_t* const* in, int inOffset, uint8_t* const* out, int outOffset, int count, int channelCount     \
+	)                                                                                                              \
+	{                                                                                                              \
+		for (int c = 0; c < channelCount; c++)                                                                     \
+		{                                                                                                          \
+			SampleConverter_Run_##IN##_##OUT(                                                                      \
+				(const TYPE_##IN*)in[c] + inOffset, (TYPE_##OUT*)out[c] + outOffset, count                         \
+			);                                                                                                     \
+		}                                                                                                          \
+	}                                                                                                              \
+                                                                                                                   \
+	static void SampleConverter_PlanarToPacked_##IN##_##OUT(                                                       \
+		const uint8_t* const* in, int inOffset, uint8_t* const* out, int outOffset, int count, int channelCount     \
+	)                                                                                                              \
+	{                                                                                                              \
+		TYPE_##OUT* dst = (TYPE_##OUT*)out[0] + (size_t)outOffset * channelCount;                                 \
+		if (channelCount == 2)                                                                                     \
+		{                                                                                                          \
+			SampleConverter_Interleave2_##IN##_##OUT(                                                              \
+				(const TYPE_##IN*)in[0] + inOffset, (const TYPE_##IN*)in[1] + inOffset, dst, count                 \
+			);                                                                                                     \
+			return;                                                                                                \
+		}                                                                                                          \
+                                                                                                                   \
+		SampleConverter_InterleaveN_##IN##_##OUT(in, inOffset, dst, count, channelCount);                          \
+	}                                                                                                              \
+                                                                                                                   \
+	static void SampleConverter_PackedToPlanar_##IN##_##OUT(                                                       \
+		const uint8_t* const* in, int inOffset, uint8_t* const* out, int outOffset, int count, int channelCount     \
+	)                                                                                                              \
+	{                                                                                                              \
+		const TYPE_##IN* src = (const TYPE_##IN*)in[0] + (size_t)inOffset * channelCount;                         \
+		for (int c = 0; c < channelCount; c++)                                                                     \
+		{                                                                                                          \
+			TYPE_##OUT* dst = (TYPE_##OUT*)out[c] + outOffset;                                                     \
+			for (int i = 0; i < count; i++)                                                                        \
+				dst[i] = CONVERT_##IN##_##OUT(src[(size_t)i * channelCount + c]);                                  \
+		}                                                                                                          \
+	}
+
+#define SAMPLE_CONVERTER_GENERIC(IN, OUT)                                                                          \
+	SAMPLE_CONVERTER_RUN(IN, OUT)                                                                                  \
+	SAMPLE_CONVERTER_INTERLEAVE2(IN, OUT)                                                                          \
+	SAMPLE_CONVERTER_INTERLEAVEN(IN, OUT)                                                                          \
+	SAMPLE_CONVERTER_LAYOUTS(IN, OUT)
+
+#ifdef SAMPLE_CONVERTER_SSE2
+// convert 4 samples to float the same way as CONVERT_*_FLT
+static inline __m128 SampleConverter_Load_S16(const int16_t* in)
+{
+	// duplicate each sample into upper half of 32bit lane and shift it back down to extend sign
+	__m128i v = _mm_loadl_epi64((const __m128i*)in);
+	__m128 f = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+	return _mm_mul_ps(f, _mm_set1_ps(1.0f / (1 << 15)));
+}
+
+static inline __m128 SampleConverter_Load_S32(const int32_t* in)
+{
+	__m128 f = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)in));
+	return _mm_mul_ps(f, _mm_set1_ps(1.0f / (1U << 31)));
+}
+
+static inline __m128 SampleConverter_Load_FLT(const float* in)
+{
+	return _mm_loadu_ps(in);
+}
+
+static inline __m128 SampleConverter_Load_DBL(const double* in)
+{
+	return _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(in)), _mm_cvtpd_ps(_mm_loadu_pd(in + 2)));
+}
+
+#define SAMPLE_CONVERTER_RUN_SSE2(IN)                                                                              \
+	static void SampleConverter_Run_##IN##_FLT(const TYPE_##IN* restrict in, float* restrict out, size_t count)    \
+	{                                                                                                              \
+		size_t i = 0;                                                                                              \
+		for (; i + 4 <= count; i += 4)                                                                             \
+			_mm_storeu_ps(out + i, SampleConverter_Load_##IN(in + i));                                             \
+		for (; i < count; i++)                                                                                     \
+			out[i] = CONVERT_##IN##_FLT(in[i]);                                                                    \
+	}
+
+#define SAMPLE_CONVERTER_INTERLEAVE2_SSE2(IN)                                                                      \
+	static void SampleConverter_Interleave2_##IN##_FLT(                                                            \
+		const TYPE_##IN* restrict left, const TYPE_##IN* restrict right, float* restrict out, size_t count         \
+	)                                                                                                              \
+	{                                                                                                              \
+		size_t i = 0;                                                                                              \
+		for (; i + 4 <= count; i += 4)                                                                             \
+		{                                                                                                          \
+			__m128 l = SampleConverter_Load_##IN(left + i);                                                        \
+			__m128 r = SampleConverter_Load_##IN(right + i);                                                       \
+			_mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));                                                     \
+			_mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));                                                 \
+		}                                                                                                          \
+		for (; i < count; i++)                                                                                     \
+		{                                                                                                          \
+			out[2 * i] = CONVERT_##IN##_FLT(left[i]);                                                              \
+			out[2 * i + 1] = CONVERT_##IN##_FLT(right[i]);                                                         \
+		}                                                                                                          \
+	}
+
+// groups of 4 channels are transposed, so that each store writes 4 channels of one sample. a remaining pair of
+// channels is written with 64bit stores
+#define SAMPLE_CONVERTER_INTERLEAVEN_SSE2(IN)                                                                      \
+	static void SampleConverter_InterleaveN_##IN##_FLT(                                                            \
+		const uint8_t* const* in, int inOffset, float* restrict out, size_t count, int channelCount                \
+	)                                                                                                              \
+	{                                                                                                              \
+		size_t stride = (size_t)channelCount;                                                                      \
+		int c = 0;                                                                                                 \
+		for (; c + 4 <= channelCount; c += 4)                                                                      \
+		{                                                                                                          \
+			const TYPE_##IN* src0 = (const TYPE_##IN*)in[c] + inOffset;                                            \
+			const TYPE_##IN* src1 = (const TYPE_##IN*)in[c + 1] + inOffset;                                        \
+			const TYPE_##IN* src2 = (const TYPE_##IN*)in[c + 2] + inOffset;                                        \
+			const TYPE_##IN* src3 = (const TYPE_##IN*)in[c + 3] + inOffset;                                        \
+			size_t i = 0;                                                                                          \
+			for (; i + 4 <= count; i += 4)                                                                         \
+			{                                                                                                      \
+				__m128 v0 = SampleConverter_Load_##IN(src0 + i);                                                   \
+				__m128 v1 = SampleConverter_Load_##IN(src1 + i);                                                   \
+				__m128 v2 = SampleConverter_Load_##IN(src2 + i);                                                   \
+				__m128 v3 = SampleConverter_Load_##IN(src3 + i);                                                   \
+				_MM_TRANSPOSE4_PS(v0, v1, v2, v3);                                                                 \
+				_mm_storeu_ps(out + i * stride + c, v0);                                                           \
+				_mm_storeu_ps(out + (i + 1) * stride + c, v1);                                                     \
+				_mm_storeu_ps(out + (i + 2) * stride + c, v2);                                                     \
+				_mm_storeu_ps(out + (i + 3) * stride + c, v3);                                                     \
+			}                                                                                                      \
+			for (; i < count; i++)                                                                                 \
+			{                                                                                                      \
+				out[i * stride + c] = CONVERT_##IN##_FLT(src0[i]);                                                 \
+				out[i * stride + c + 1] = CONVERT_##IN##_FLT(src1[i]);                                             \
+				out[i * stride + c + 2] = CONVERT_##IN##_FLT(src2[i]);                                             \
+				out[i * stride + c + 3] = CONVERT_##IN##_FLT(src3[i]);                                             \
+			}                                                                                                      \
+		}                                                                                                          \
+		if (c + 2 <= channelCount)                                                                                 \
+		{                                                                                                          \
+			const TYPE_##IN* src0 = (const TYPE_##IN*)in[c] + inOffset;                                            \
+			const TYPE_##IN* src1 = (const TYPE_##IN*)in[c + 1] + inOffset;                                        \
+			size_t i = 0;                                                                                          \
+			for (; i + 4 <= count; i += 4)                                                                         \
+			{                                                                                                      \
+				__m128 v0 = SampleConverter_Load_##IN(src0 + i);                                                   \
+				__m128 v1 = SampleConverter_Load_##IN(src1 + i);                                                   \
+				__m128 lo = _mm_unpacklo_ps(v0, v1);                                                               \
+				__m128 hi = _mm_unpackhi_ps(v0, v1);                                                               \
+				_mm_storel_pi((__m64*)(out + i * stride + c), lo);                                                 \
+				_mm_storeh_pi((__m64*)(out + (i + 1) * stride + c), lo);                                           \
+				_mm_storel_pi((__m64*)(out + (i + 2) * stride + c), hi);                                           \
+				_mm_storeh_pi((__m64*)(out + (i + 3) * stride + c), hi);                                           \
+			}                                                                                                      \
+			for (; i < count; i++)                                                                                 \
+			{                                                                                                      \
+				out[i * stride + c] = CONVERT_##IN##_FLT(src0[i]);                                                 \
+				out[i * stride + c + 1] = CONVERT_##IN##_FLT(src1[i]);                                             \
+			}                                                                                                      \
+			c += 2;                                                                                                \
+		}                                                                                                          \
+		if (c < channelCount)                                                                                      \
+		{                                                                                                          \
+			const TYPE_##IN* src = (const TYPE_##IN*)in[c] + inOffset;                                             \
+			for (size_t i = 0; i < count; i++)                                                                     \
+				out[i * stride + c] = CONVERT_##IN##_FLT(src[i]);                                                  \
+		}                                                                                                          \
+	}
+
+static void SampleConverter_Run_FLT_S16(const float* restrict in, int16_t* restrict out, size_t count)
+{
+	// clamp before conversion, out of range floats would turn into INT_MIN. cvtps rounds to nearest like lrintf
+	const __m128 scale = _mm_set1_ps(1 << 15);
+	const __m128 minValue = _mm_set1_ps(-32768.0f);
+	const __m128 maxValue = _mm_set1_ps(32767.0f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128 lo = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), minValue), maxValue);
+		__m128 hi = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), minValue), maxValue);
+		__m128i v = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+		_mm_storeu_si128((__m128i*)(out + i), v);
+	}
+	for (; i < count; i++)
+		out[i] = CONVERT_FLT_S16(in[i]);
+}
+
+static void SampleConverter_Run_FLT_S32(const float* restrict in, int32_t* restrict out, size_t count)
+{
+	// out of range floats turn into INT_MIN, which is already right for negative ones. flipping all bits of positive
+	// ones gives INT_MAX like av_clipl_int32
+	const __m128 scale = _mm_set1_ps(2147483648.0f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 f = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+		__m128i v = _mm_cvtps_epi32(f);
+		v = _mm_xor_si128(v, _mm_castps_si128(_mm_cmpge_ps(f, scale)));
+		_mm_storeu_si128((__m128i*)(out + i), v);
+	}
+	for (; i < count; i++)
+		out[i] = CONVERT_FLT_S32(in[i]);
+}
+
+static void SampleConverter_Run_FLT_DBL(const float* restrict in, double* restrict out, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 f = _mm_loadu_ps(in + i);
+		_mm_storeu_pd(out + i, _mm_cvtps_pd(f));
+		_mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+	}
+	for (; i < count; i++)
+		out[i] = CONVERT_FLT_DBL(in[i]);
+}
+
+SAMPLE_CONVERTER_RUN_SSE2(S16)
+SAMPLE_CONVERTER_RUN_SSE2(S32)
+SAMPLE_CONVERTER_RUN_SSE2(DBL)
+SAMPLE_CONVERTER_RUN(FLT, FLT)
+SAMPLE_CONVERTER_RUN(S16, S16)
+SAMPLE_CONVERTER_INTERLEAVE2_SSE2(S16)
+SAMPLE_CONVERTER_INTERLEAVE2_SSE2(S32)
+SAMPLE_CONVERTER_INTERLEAVE2_SSE2(FLT)
+SAMPLE_CONVERTER_INTERLEAVE2_SSE2(DBL)
+SAMPLE_CONVERTER_INTERLEAVE2(S16, S16)
+SAMPLE_CONVERTER_INTERLEAVE2(FLT, S16)
+SAMPLE_CONVERTER_INTERLEAVE2(FLT, S32)
+SAMPLE_CONVERTER_INTERLEAVE2(FLT, DBL)
+SAMPLE_CONVERTER_INTERLEAVEN_SSE2(S16)
+SAMPLE_CONVERTER_INTERLEAVEN_SSE2(S32)
+SAMPLE_CONVERTER_INTERLEAVEN_SSE2(FLT)
+SAMPLE_CONVERTER_INTERLEAVEN_SSE2(DBL)
+SAMPLE_CONVERTER_INTERLEAVEN(S16, S16)
+SAMPLE_CONVERTER_INTERLEAVEN(FLT, S16)
+SAMPLE_CONVERTER_INTERLEAVEN(FLT, S32)
+SAMPLE_CONVERTER_INTERLEAVEN(FLT, DBL)
+SAMPLE_CONVERTER_LAYOUTS(S16, S16)
+SAMPLE_CONVERTER_LAYOUTS(S16, FLT)
+SAMPLE_CONVERTER_LAYOUTS(S32, FLT)
+SAMPLE_CONVERTER_LAYOUTS(FLT, S16)
+SAMPLE_CONVERTER_LAYOUTS(FLT, S32)
+SAMPLE_CONVERTER_LAYOUTS(FLT, FLT)
+SAMPLE_CONVERTER_LAYOUTS(FLT, DBL)
+SAMPLE_CONVERTER_LAYOUTS(DBL, FLT)
+#else
+SAMPLE_CONVERTER_GENERIC(S16, S16)
+SAMPLE_CONVERTER_GENERIC(S16, FLT)
+SAMPLE_CONVERTER_GENERIC(S32, FLT)
+SAMPLE_CONVERTER_GENERIC(FLT, S16)
+SAMPLE_CONVERTER_GENERIC(FLT, S32)
+SAMPLE_CONVERTER_GENERIC(FLT, FLT)
+SAMPLE_CONVERTER_GENERIC(FLT, DBL)
+SAMPLE_CONVERTER_GENERIC(DBL, FLT)
+#endif
+
+SAMPLE_CONVERTER_GENERIC(U8, U8)
+SAMPLE_CONVERTER_GENERIC(U8, S16)
+SAMPLE_CONVERTER_GENERIC(U8, S32)
+SAMPLE_CONVERTER_GENERIC(U8, FLT)
+SAMPLE_CONVERTER_GENERIC(U8, DBL)
+SAMPLE_CONVERTER_GENERIC(S16, U8)
+SAMPLE_CONVERTER_GENERIC(S16, S32)
+SAMPLE_CONVERTER_GENERIC(S16, DBL)
+SAMPLE_CONVERTER_GENERIC(S32, U8)
+SAMPLE_CONVERTER_GENERIC(S32, S16)
+SAMPLE_CONVERTER_GENERIC(S32, S32)
+SAMPLE_CONVERTER_GENERIC(S32, DBL)
+SAMPLE_CONVERTER_GENERIC(FLT, U8)
+SAMPLE_CONVERTER_GENERIC(DBL, U8)
+SAMPLE_CONVERTER_GENERIC(DBL, S16)
+SAMPLE_CONVERTER_GENERIC(DBL, S32)
+SAMPLE_CONVERTER_GENERIC(DBL, DBL)
+
+// indexed by (input is planar) * 2 + (output is planar)
+#define SAMPLE_CONVERTER_ENTRY(IN, OUT)                                                                            \
+	{                                                                                                              \
+		&SampleConverter_PackedToPacked_##IN##_##OUT, &SampleConverter_PackedToPlanar_##IN##_##OUT,               \
+			&SampleConverter_PlanarToPacked_##IN##_##OUT, &SampleConverter_PlanarToPlanar_##IN##_##OUT             \
+	}
+
+#define SAMPLE_CONVERTER_ROW(IN)                                                                                   \
+	{                                                                                                              \
+		SAMPLE_CONVERTER_ENTRY(IN, U8), SAMPLE_CONVERTER_ENTRY(IN, S16), SAMPLE_CONVERTER_ENTRY(IN, S32),          \
+			SAMPLE_CONVERTER_ENTRY(IN, FLT), SAMPLE_CONVERTER_ENTRY(IN, DBL)                                       \
+	}
+
+// rows and columns are in order of packed AVSampleFormat values
+static const SampleConverterFunc kernels[5][5][4] = {
+	SAMPLE_CONVERTER_ROW(U8),  SAMPLE_CONVERTER_ROW(S16), SAMPLE_CONVERTER_ROW(S32),
+	SAMPLE_CONVERTER_ROW(FLT), SAMPLE_CONVERTER_ROW(DBL),
+};
+
+SampleConverterFunc SampleConverter_Find(enum AVSampleFormat inFormat, enum AVSampleFormat outFormat)
+{
+	enum AVSampleFormat inPacked = av_get_packed_sample_fmt(inFormat);
+	enum AVSampleFormat outPacked = av_get_packed_sample_fmt(outFormat);
+	if (inPacked < AV_SAMPLE_FMT_U8 || inPacked > AV_SAMPLE_FMT_DBL || outPacked < AV_SAMPLE_FMT_U8 ||
+		outPacked > AV_SAMPLE_FMT_DBL)
+	{
+		return NULL;
+	}
+
+	int layout = av_sample_fmt_is_planar(inFormat) * 2 + av_sample_fmt_is_planar(outFormat);
+	return kernels[inPacked - AV_SAMPLE_FMT_U8][outPacked - AV_SAMPLE_FMT_U8][layout];
+}
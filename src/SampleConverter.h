@@ -0,0 +1,20 @@
+#pragma once
+
+#include <libavutil/samplefmt.h>
+#include <stdint.h>
+
+/// @brief Convert count samples per channel, offsets are given in samples per channel as well
+typedef void (*SampleConverterFunc)(
+	const uint8_t* const* in, int inOffset, uint8_t* const* out, int outOffset, int count, int channelCount
+);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+	/// @brief Find kernel that converts sample format and layout without changing rate or channels
+	/// @return kernel or NULL if either format is not supported
+	SampleConverterFunc SampleConverter_Find(enum AVSampleFormat inFormat, enum AVSampleFormat outFormat);
+#ifdef __cplusplus
+}
+#endif
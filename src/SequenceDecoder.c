@@ -0,0 +1,328 @@
+#include "SequenceDecoder.h"
+
+#include "Allocator.h"
+#include "ImageResizer.h"
+#include "Internal.h"
+#include "TaskQueue.h"
+#include <libavutil/cpu.h>
+#include <libavutil/imgutils.h>
+#include <threads.h>
+
+// number of frames decoded at once
+#define MIN_SLOT_COUNT 2
+#define MAX_SLOT_COUNT 16
+
+typedef enum
+{
+	SLOT_IDLE,
+	SLOT_QUEUED,
+	SLOT_RUNNING,
+	SLOT_DONE,
+} SequenceSlotState;
+
+typedef struct
+{
+	SequenceDecoder* sequence;
+	SequenceSlotState state;
+	AVPacket* packet;
+	AVFrame* frame;
+	// every slot has its own decoder, frames of intra only streams do not depend on each other
+	AVCodecContext* codec;
+	ImageResizerContext* resizer;
+
+	SequenceOutput output;
+	uint8_t* buffer;
+	uint32_t bufferSize;
+	// 1 if frame was converted into buffer, 0 if it was only decoded, -1 on error
+	int result;
+} SequenceSlot;
+
+struct SequenceDecoder
+{
+	mtx_t lock;
+	cnd_t slotDone;
+	// held by owner and by every queued task
+	int refCount;
+
+	AVCodecParameters* codecParams;
+	// ring of slots, first one holds oldest frame
+	SequenceSlot* slots;
+	uint32_t slotCount;
+	uint32_t first;
+	uint32_t count;
+};
+
+static int SequenceDecoder_Convert(SequenceSlot* slot)
+{
+	const SequenceOutput* output = &slot->output;
+	const AVFrame* frame = slot->frame;
+	if (!slot->resizer)
+	{
+		slot->resizer = ImageResizer_CreateContext();
+		if (!slot->resizer)
+			return 0;
+	}
+
+	int size = av_image_get_buffer_size(MapPixelFormat(output->pixelFormat), output->width, output->height, 1);
+	if (size < 1)
+		return 0;
+	if ((uint32_t)size != slot->bufferSize)
+	{
+		uint8_t* tmp = Allocator_Realloc(slot->buffer, size);
+		if (!tmp)
+			return 0;
+		slot->buffer = tmp;
+		slot->bufferSize = size;
+	}
+
+	MediaDecoderPlaneInfo planes[4];
+	int planeCount = FillPlaneInfo(output->pixelFormat, output->width, output->height, slot->buffer, planes);
+	ImageResizer_SetQuality(slot->resizer, output->scaleQuality);
+	if (planeCount < 1 ||
+		!ImageResizer_SetParameters(
+			slot->resizer, frame->width, frame->height, frame->format | 0x10000, output->width, output->height,
+			output->pixelFormat
+		) ||
+		!ImageResizer_SetMipChain(slot->resizer, NULL, 0, MIP_FILTER_BOX))
+	{
+		// caller tries again on its own
+		return 0;
+	}
+
+	uint8_t* outImageData[] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+	int outImageLineSize[] = {0, 0, 0, 0, 0, 0, 0, 0};
+	for (int i = 0; i < planeCount; i++)
+	{
+		outImageData[i] = planes[i].data;
+		outImageLineSize[i] = planes[i].stride;
+	}
+	ImageResizer_Resize(slot->resizer, (const uint8_t**)frame->data, frame->linesize, outImageData, outImageLineSize);
+	return 1;
+}
+
+static int SequenceDecoder_Decode(SequenceSlot* slot, const AVCodecParameters* codecParams)
+{
+	if (!slot->codec)
+	{
+		// workers already run in parallel, so each decoder uses a single thread
+		slot->codec = CreateDecoder(codecParams, 1, 0);
+		if (!slot->codec)
+			return -1;
+	}
+
+	int ret = avcodec_send_packet(slot->codec, slot->packet);
+	av_packet_unref(slot->packet);
+	if (ret < 0 || avcodec_receive_frame(slot->codec, slot->frame) < 0)
+	{
+		avcodec_flush_buffers(slot->codec);
+		return -1;
+	}
+
+	return slot->output.convert ? SequenceDecoder_Convert(slot) : 0;
+}
+
+static void SequenceDecoder_Run(SequenceDecoder* sequence, SequenceSlot* slot)
+{
+	// lock must be held, it is released while frame is decoded
+	slot->state = SLOT_RUNNING;
+	mtx_unlock(&sequence->lock);
+	int result = SequenceDecoder_Decode(slot, sequence->codecParams);
+	mtx_lock(&sequence->lock);
+	slot->result = result;
+	slot->state = SLOT_DONE;
+	cnd_broadcast(&sequence->slotDone);
+}
+
+static void SequenceDecoder_Task(void* arg)
+{
+	SequenceSlot* slot = (SequenceSlot*)arg;
+	SequenceDecoder* sequence = slot->sequence;
+
+	// slot may have been decoded by waiting caller or cancelled meanwhile
+	mtx_lock(&sequence->lock);
+	if (slot->state == SLOT_QUEUED)
+		SequenceDecoder_Run(sequence, slot);
+	mtx_unlock(&sequence->lock);
+
+	SequenceDecoder_Release(&sequence);
+}
+
+static int SequenceDecoder_IsSameOutput(const SequenceOutput* a, const SequenceOutput* b)
+{
+	return a->convert == b->convert && a->width == b->width && a->height == b->height &&
+		   a->pixelFormat == b->pixelFormat && a->scaleQuality == b->scaleQuality;
+}
+
+SequenceDecoder* SequenceDecoder_Create(const AVCodecParameters* codecParams)
+{
+	SequenceDecoder* sequence = Allocator_Calloc(1, sizeof(*sequence));
+	if (!sequence)
+		return NULL;
+
+	mtx_init(&sequence->lock, mtx_plain);
+	cnd_init(&sequence->slotDone);
+	sequence->refCount = 1;
+
+	// parameters are copied, demuxer they belong to may be closed while frames are still being decoded
+	int slotCount = av_cpu_count();
+	if (slotCount < MIN_SLOT_COUNT)
+		slotCount = MIN_SLOT_COUNT;
+	if (slotCount > MAX_SLOT_COUNT)
+		slotCount = MAX_SLOT_COUNT;
+	sequence->slotCount = slotCount;
+	sequence->codecParams = avcodec_parameters_alloc();
+	sequence->slots = Allocator_Calloc(sequence->slotCount, sizeof(*sequence->slots));
+	if (!sequence->codecParams || !sequence->slots || avcodec_parameters_copy(sequence->codecParams, codecParams) < 0)
+	{
+		SequenceDecoder_Release(&sequence);
+		return NULL;
+	}
+
+	for (uint32_t i = 0; i < sequence->slotCount; i++)
+	{
+		SequenceSlot* slot = &sequence->slots[i];
+		slot->sequence = sequence;
+		slot->packet = av_packet_alloc();
+		slot->frame = av_frame_alloc();
+		if (!slot->packet || !slot->frame)
+		{
+			SequenceDecoder_Release(&sequence);
+			return NULL;
+		}
+	}
+
+	return sequence;
+}
+
+void SequenceDecoder_Release(SequenceDecoder** sequence)
+{
+	if (!sequence || !*sequence)
+		return;
+
+	SequenceDecoder* s = *sequence;
+	*sequence = NULL;
+	mtx_lock(&s->lock);
+	int refCount = --s->refCount;
+	mtx_unlock(&s->lock);
+	if (refCount > 0)
+		return;
+
+	if (s->slots)
+	{
+		for (uint32_t i = 0; i < s->slotCount; i++)
+		{
+			SequenceSlot* slot = &s->slots[i];
+			av_packet_free(&slot->packet);
+			av_frame_free(&slot->frame);
+			if (slot->codec)
+				avcodec_free_context(&slot->codec);
+			if (slot->resizer)
+				ImageResizer_ReleaseContext(&slot->resizer);
+			Allocator_Free(slot->buffer);
+		}
+		Allocator_Free(s->slots);
+	}
+	avcodec_parameters_free(&s->codecParams);
+	cnd_destroy(&s->slotDone);
+	mtx_destroy(&s->lock);
+	Allocator_Free(s);
+}
+
+int SequenceDecoder_IsFull(SequenceDecoder* sequence)
+{
+	mtx_lock(&sequence->lock);
+	int isFull = sequence->count == sequence->slotCount;
+	mtx_unlock(&sequence->lock);
+	return isFull;
+}
+
+int SequenceDecoder_Push(SequenceDecoder* sequence, const AVPacket* packet, const SequenceOutput* output)
+{
+	mtx_lock(&sequence->lock);
+	SequenceSlot* slot = &sequence->slots[(sequence->first + sequence->count) % sequence->slotCount];
+	if (sequence->count == sequence->slotCount || av_packet_ref(slot->packet, packet) < 0)
+	{
+		mtx_unlock(&sequence->lock);
+		return -1;
+	}
+
+	// task of previous use of slot may still be queued, whichever task comes first decodes it
+	slot->output = *output;
+	slot->result = -1;
+	slot->state = SLOT_QUEUED;
+	sequence->count++;
+	sequence->refCount++;
+	mtx_unlock(&sequence->lock);
+
+	if (TaskQueue_Push(&SequenceDecoder_Task, slot))
+	{
+		// frame is decoded by caller once it is oldest one
+		SequenceDecoder* ref = sequence;
+		SequenceDecoder_Release(&ref);
+	}
+	return 0;
+}
+
+int SequenceDecoder_Take(
+	SequenceDecoder* sequence, AVFrame* frame, const SequenceOutput* output, uint8_t** buffer, uint32_t* bufferSize
+)
+{
+	mtx_lock(&sequence->lock);
+	if (sequence->count == 0)
+	{
+		mtx_unlock(&sequence->lock);
+		return AVERROR_EOF;
+	}
+
+	// oldest frame is decoded right here if no worker started on it yet, rather than waiting for a free worker
+	SequenceSlot* slot = &sequence->slots[sequence->first];
+	if (slot->state == SLOT_QUEUED)
+		SequenceDecoder_Run(sequence, slot);
+	while (slot->state != SLOT_DONE)
+		cnd_wait(&sequence->slotDone, &sequence->lock);
+
+	sequence->first = (sequence->first + 1) % sequence->slotCount;
+	sequence->count--;
+	slot->state = SLOT_IDLE;
+
+	int result = slot->result;
+	av_frame_unref(frame);
+	if (result >= 0)
+		av_frame_move_ref(frame, slot->frame);
+	av_frame_unref(slot->frame);
+
+	if (result == 1 && !SequenceDecoder_IsSameOutput(&slot->output, output))
+		result = 0;
+	if (result == 1)
+	{
+		// converted image is handed over, previous buffer of caller is reused for a following frame
+		uint8_t* tmp = *buffer;
+		uint32_t tmpSize = *bufferSize;
+		*buffer = slot->buffer;
+		*bufferSize = slot->bufferSize;
+		slot->buffer = tmp;
+		slot->bufferSize = tmp ? tmpSize : 0;
+	}
+
+	mtx_unlock(&sequence->lock);
+	return result;
+}
+
+void SequenceDecoder_Cancel(SequenceDecoder* sequence)
+{
+	mtx_lock(&sequence->lock);
+	for (uint32_t i = 0; i < sequence->count; i++)
+	{
+		SequenceSlot* slot = &sequence->slots[(sequence->first + i) % sequence->slotCount];
+
+		// decoder of slot can only be reused once worker is done with it
+		while (slot->state == SLOT_RUNNING)
+			cnd_wait(&sequence->slotDone, &sequence->lock);
+		slot->state = SLOT_IDLE;
+		av_packet_unref(slot->packet);
+		av_frame_unref(slot->frame);
+	}
+	sequence->first = 0;
+	sequence->count = 0;
+	mtx_unlock(&sequence->lock);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "MediaDecoder.h"
+#include <libavcodec/avcodec.h>
+#include <stdint.h>
+
+typedef struct SequenceDecoder SequenceDecoder;
+
+typedef struct SequenceOutput
+{
+	uint32_t width;
+	uint32_t height;
+	MediaDecoderPixelFormat pixelFormat;
+	MediaDecoderScaleQuality scaleQuality;
+	// when 0, frames are only decoded and left to be converted by caller
+	int convert;
+} SequenceOutput;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+	/// @brief Create decoder that decodes frames of an intra only stream on worker threads, several at once
+	SequenceDecoder* SequenceDecoder_Create(const AVCodecParameters* codecParams);
+	void SequenceDecoder_Release(SequenceDecoder** sequence);
+
+	/// @return 1 if no more packets can be queued until oldest frame is taken
+	int SequenceDecoder_IsFull(SequenceDecoder* sequence);
+
+	/// @brief Queue packet to be decoded, and converted to output if output->convert is set
+	/// @return 0 on success
+	int SequenceDecoder_Push(SequenceDecoder* sequence, const AVPacket* packet, const SequenceOutput* output);
+
+	/// @brief Wait for oldest queued frame and move it into frame
+	/// @param output settings of caller, converted image is only returned if it was converted with same settings
+	/// @param buffer buffer of bufferSize bytes that is exchanged with converted image
+	/// @return 1 if buffer contains converted frame, 0 if frame still needs to be converted, AVERROR_EOF if no frame
+	/// was queued, -1 if frame could not be decoded
+	int SequenceDecoder_Take(
+		SequenceDecoder* sequence, AVFrame* frame, const SequenceOutput* output, uint8_t** buffer, uint32_t* bufferSize
+	);
+
+	/// @brief Drop all queued frames, e.g. before seeking
+	void SequenceDecoder_Cancel(SequenceDecoder* sequence);
+#ifdef __cplusplus
+}
+#endif
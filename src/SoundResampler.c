@@ -1,28 +1,266 @@
 #include "SoundResampler.h"
+#include "Allocator.h"
 #include "Internal.h"
+#include "SampleConverter.h"
+#include <libavutil/opt.h>
 #include <libswresample/swresample.h>
+#include <string.h>
+
+#define MAX_CHANNELS 64
 
 typedef struct
 {
 	struct SwrContext* ctx;
+
+	// used instead of swresample if only sample format or layout changes
+	SampleConverterFunc convert;
+	enum AVSampleFormat convertFormat;
+	int channelCount;
+	// converted samples that did not fit into output, in output format
+	uint8_t* pendingBuffer;
+	uint8_t* pending[MAX_CHANNELS];
+	int pendingStart;
+	int pendingCount;
+	int pendingCapacity;
+
 	int cacheInSampleRate;
 	enum MediaDecoderChannelLayout cacheInChannelLayout;
 	enum MediaDecoderSampleFormat cacheInFormat;
 	int cacheOutSampleRate;
 	enum MediaDecoderChannelLayout cacheOutChannelLayout;
 	enum MediaDecoderSampleFormat cacheOutFormat;
+	enum MediaDecoderResampleQuality quality;
 } InternalState;
 
+static void SoundResampler_ApplyQuality(struct SwrContext* swr, enum MediaDecoderResampleQuality quality, bool useSoxr)
+{
+	switch (quality)
+	{
+	case RESAMPLE_QUALITY_PREVIEW:
+		// short filter with few phases, audible aliasing is acceptable
+		av_opt_set_int(swr, "filter_size", 4, 0);
+		av_opt_set_int(swr, "phase_shift", 6, 0);
+		av_opt_set_int(swr, "linear_interp", 0, 0);
+		av_opt_set_double(swr, "cutoff", 0.75, 0);
+		break;
+
+	case RESAMPLE_QUALITY_REALTIME:
+		av_opt_set_int(swr, "filter_size", 16, 0);
+		av_opt_set_int(swr, "phase_shift", 8, 0);
+		av_opt_set_int(swr, "linear_interp", 1, 0);
+		av_opt_set_double(swr, "cutoff", 0.9, 0);
+		break;
+
+	case RESAMPLE_QUALITY_MASTERING:
+		if (useSoxr)
+		{
+			av_opt_set_int(swr, "resampler", SWR_ENGINE_SOXR, 0);
+			av_opt_set_double(swr, "precision", 28, 0);
+			av_opt_set_int(swr, "cheby", 1, 0);
+		}
+		else
+		{
+			av_opt_set_int(swr, "filter_size", 64, 0);
+			av_opt_set_int(swr, "phase_shift", 14, 0);
+			av_opt_set_int(swr, "linear_interp", 1, 0);
+			av_opt_set_int(swr, "exact_rational", 1, 0);
+			av_opt_set_double(swr, "cutoff", 0.97, 0);
+			av_opt_set_double(swr, "kaiser_beta", 12, 0);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+static bool SoundResampler_ReservePending(InternalState* ctx, int count)
+{
+	if (ctx->pendingStart + ctx->pendingCount + count <= ctx->pendingCapacity)
+		return true;
+
+	// move pending samples to start of a new buffer that has room for count more
+	int capacity = FFMAX(ctx->pendingCapacity, ctx->pendingCount + count);
+	int size = av_samples_get_buffer_size(NULL, ctx->channelCount, capacity, ctx->convertFormat, 1);
+	uint8_t* buffer = size > 0 ? Allocator_Alloc(size) : NULL;
+	if (!buffer)
+		return false;
+
+	uint8_t* planes[MAX_CHANNELS];
+	av_samples_fill_arrays(planes, NULL, buffer, ctx->channelCount, capacity, ctx->convertFormat, 1);
+	av_samples_copy(
+		planes, ctx->pending, 0, ctx->pendingStart, ctx->pendingCount, ctx->channelCount, ctx->convertFormat
+	);
+
+	Allocator_Free(ctx->pendingBuffer);
+	ctx->pendingBuffer = buffer;
+	memcpy(ctx->pending, planes, sizeof(planes));
+	ctx->pendingStart = 0;
+	ctx->pendingCapacity = capacity;
+	return true;
+}
+
+static int SoundResampler_TakePending(InternalState* ctx, uint8_t** outSoundData, int outSampleCountPerChannel)
+{
+	int count = FFMIN(ctx->pendingCount, outSampleCountPerChannel);
+	if (count <= 0)
+		return 0;
+
+	av_samples_copy(outSoundData, ctx->pending, 0, ctx->pendingStart, count, ctx->channelCount, ctx->convertFormat);
+	ctx->pendingStart += count;
+	ctx->pendingCount -= count;
+	if (ctx->pendingCount == 0)
+		ctx->pendingStart = 0;
+	return count;
+}
+
+static void SoundResampler_OffsetPlanes(InternalState* ctx, uint8_t** planes, uint8_t** data, int offset)
+{
+	int bytesPerSample = av_get_bytes_per_sample(ctx->convertFormat);
+	if (!av_sample_fmt_is_planar(ctx->convertFormat))
+	{
+		planes[0] = data[0] + (size_t)offset * ctx->channelCount * bytesPerSample;
+		return;
+	}
+
+	for (int i = 0; i < ctx->channelCount; i++)
+		planes[i] = data[i] + (size_t)offset * bytesPerSample;
+}
+
+/// @brief Move samples that swresample holds back into pending buffer, so that its context can be freed
+static bool SoundResampler_DrainToPending(InternalState* ctx)
+{
+	if (ctx->channelCount > MAX_CHANNELS)
+		return false;
+
+	while (1)
+	{
+		int count = FFMAX(swr_get_out_samples(ctx->ctx, 0), 256);
+		if (!SoundResampler_ReservePending(ctx, count))
+			return false;
+
+		uint8_t* planes[MAX_CHANNELS];
+		SoundResampler_OffsetPlanes(ctx, planes, ctx->pending, ctx->pendingStart + ctx->pendingCount);
+		int written = swr_convert(ctx->ctx, planes, count, NULL, 0);
+		if (written <= 0)
+			return written == 0;
+
+		ctx->pendingCount += written;
+		if (written < count)
+			return true;
+	}
+}
+
+/// @brief Write pending samples first, then what swresample returns for input
+static int SoundResampler_ConvertAfterPending(
+	InternalState* ctx, const uint8_t** inSoundData, int inSampleCountPerChannel, uint8_t** outSoundData,
+	int outSampleCountPerChannel
+)
+{
+	int written = SoundResampler_TakePending(ctx, outSoundData, outSampleCountPerChannel);
+	uint8_t* planes[MAX_CHANNELS];
+	SoundResampler_OffsetPlanes(ctx, planes, outSoundData, written);
+
+	// input is still passed in when output is full, swresample buffers it
+	int ret = swr_convert(ctx->ctx, planes, outSampleCountPerChannel - written, inSoundData, inSampleCountPerChannel);
+	return ret < 0 ? ret : written + ret;
+}
+
+static int SoundResampler_Convert(
+	InternalState* ctx, const uint8_t** inSoundData, int inSampleCountPerChannel, uint8_t** outSoundData,
+	int outSampleCountPerChannel
+)
+{
+	// samples left over from previous call come first
+	int written = SoundResampler_TakePending(ctx, outSoundData, outSampleCountPerChannel);
+	int count = FFMIN(inSampleCountPerChannel, outSampleCountPerChannel - written);
+	if (count > 0)
+		ctx->convert(inSoundData, 0, outSoundData, written, count, ctx->channelCount);
+	count = FFMAX(count, 0);
+
+	// keep rest like swresample would
+	int rest = inSampleCountPerChannel - count;
+	if (rest > 0)
+	{
+		if (!SoundResampler_ReservePending(ctx, rest))
+			return -1;
+		ctx->convert(
+			inSoundData, count, ctx->pending, ctx->pendingStart + ctx->pendingCount, rest, ctx->channelCount
+		);
+		ctx->pendingCount += rest;
+	}
+
+	return written + count;
+}
+
+/// @brief Create swresample context or select conversion kernel for cached parameters
+static bool SoundResampler_Open(InternalState* ctx)
+{
+	enum AVSampleFormat inFormatRaw = MapSampleFormat(ctx->cacheInFormat);
+	if (inFormatRaw == AV_SAMPLE_FMT_NONE)
+		inFormatRaw = ((enum AVSampleFormat)ctx->cacheInFormat) & 0xFFFF;
+
+	enum AVSampleFormat outFormatRaw = MapSampleFormat(ctx->cacheOutFormat);
+	if (outFormatRaw == AV_SAMPLE_FMT_NONE)
+		outFormatRaw = ((enum AVSampleFormat)ctx->cacheOutFormat) & 0xFFFF;
+
+	// ctx->ctx = swr_alloc_set_opts(ctx->ctx, outChannelLayout, outFormat, outSampleRate, inChannelLayout, inFormat,
+	// inSampleRate, 0, NULL);
+
+	struct AVChannelLayout inChLay = FromEnumToChannelLayout(ctx->cacheInChannelLayout);
+	struct AVChannelLayout outChLay = FromEnumToChannelLayout(ctx->cacheOutChannelLayout);
+
+	// pending samples are kept in output format, both for conversion kernels and for draining swresample
+	ctx->convertFormat = outFormatRaw;
+	ctx->channelCount = outChLay.nb_channels;
+
+	// without rate change or remix samples only need to be converted, which kernels do much faster than swresample
+	if (ctx->cacheInSampleRate == ctx->cacheOutSampleRate &&
+		ctx->cacheInChannelLayout == ctx->cacheOutChannelLayout && inChLay.nb_channels > 0 &&
+		inChLay.nb_channels <= MAX_CHANNELS)
+	{
+		ctx->convert = SampleConverter_Find(inFormatRaw, outFormatRaw);
+		if (ctx->convert)
+			return true;
+	}
+
+	// soxr is only available if ffmpeg was built with it, otherwise fall back to swresample's own engine
+	for (int useSoxr = ctx->quality == RESAMPLE_QUALITY_MASTERING; useSoxr >= 0; useSoxr--)
+	{
+		if (swr_alloc_set_opts2(
+				&ctx->ctx, &outChLay, outFormatRaw, ctx->cacheOutSampleRate, &inChLay, inFormatRaw,
+				ctx->cacheInSampleRate, 0, NULL
+			))
+		{
+			break;
+		}
+
+		SoundResampler_ApplyQuality(ctx->ctx, ctx->quality, useSoxr);
+		if (swr_init(ctx->ctx) >= 0)
+			break;
+
+		swr_free(&ctx->ctx);
+	}
+
+	return ctx->ctx != NULL;
+}
+
 SoundResamplerContext* SoundResampler_CreateContext()
 {
-	InternalState* ctx = malloc(sizeof(*ctx));
+	InternalState* ctx = Allocator_Alloc(sizeof(*ctx));
 	ctx->ctx = NULL;
+	ctx->convert = NULL;
+	ctx->pendingBuffer = NULL;
+	ctx->pendingStart = 0;
+	ctx->pendingCount = 0;
+	ctx->pendingCapacity = 0;
 	ctx->cacheInSampleRate = -1;
 	ctx->cacheInChannelLayout = CHANNEL_LAYOUT_STEREO;
 	ctx->cacheInFormat = SAMPLE_FORMAT_UNKNOWN;
 	ctx->cacheOutSampleRate = -1;
 	ctx->cacheOutChannelLayout = CHANNEL_LAYOUT_STEREO;
 	ctx->cacheOutFormat = SAMPLE_FORMAT_UNKNOWN;
+	ctx->quality = RESAMPLE_QUALITY_DEFAULT;
 
 	return (SoundResamplerContext*)ctx;
 }
@@ -35,13 +273,13 @@ bool SoundResampler_SetParameters(
 {
 	InternalState* ctx = (InternalState*)context;
 
-	if (ctx->ctx)
+	if (ctx->ctx || ctx->convert)
 	{
 		if (inSampleRate == ctx->cacheInSampleRate && inChannelLayout == ctx->cacheInChannelLayout &&
 			inFormat == ctx->cacheInFormat && outSampleRate == ctx->cacheOutSampleRate &&
 			outChannelLayout == ctx->cacheOutChannelLayout && outFormat == ctx->cacheOutFormat)
 		{
-			return ctx->ctx;
+			return true;
 		}
 	}
 
@@ -52,27 +290,35 @@ bool SoundResampler_SetParameters(
 	ctx->cacheOutChannelLayout = outChannelLayout;
 	ctx->cacheOutFormat = outFormat;
 	swr_free(&ctx->ctx);
-	// ctx->ctx = swr_alloc_set_opts(ctx->ctx, outChannelLayout, outFormat, outSampleRate, inChannelLayout, inFormat,
-	// inSampleRate, 0, NULL);
+	ctx->convert = NULL;
+	ctx->pendingStart = 0;
+	ctx->pendingCount = 0;
+	return SoundResampler_Open(ctx);
+}
 
-	struct AVChannelLayout inChLay = FromEnumToChannelLayout(inChannelLayout);
-	struct AVChannelLayout outChLay = FromEnumToChannelLayout(outChannelLayout);
+void SoundResampler_SetQuality(SoundResamplerContext* context, enum MediaDecoderResampleQuality quality)
+{
+	InternalState* ctx = (InternalState*)context;
+	if (ctx->quality == quality)
+		return;
 
-	if (!swr_alloc_set_opts2(
-			&ctx->ctx, &outChLay, (enum AVSampleFormat)outFormat, outSampleRate, &inChLay,
-			(enum AVSampleFormat)inFormat, inSampleRate, 0, NULL
-		))
-	{
-		swr_init(ctx->ctx);
-	}
+	ctx->quality = quality;
+	if (!ctx->ctx)
+		return;
 
-	return ctx->ctx != NULL;
+	// samples swresample still holds are written with old filter before it is replaced, none get lost
+	if (!SoundResampler_DrainToPending(ctx))
+		ctx->pendingCount = 0;
+	swr_free(&ctx->ctx);
+	SoundResampler_Open(ctx);
 }
 
 int SoundResampler_FindMaxOutputSamples(SoundResamplerContext* context, int inSampleCountPerChannel)
 {
 	InternalState* ctx = (InternalState*)context;
-	return swr_get_out_samples(ctx->ctx, inSampleCountPerChannel);
+	if (ctx->convert)
+		return ctx->pendingCount + inSampleCountPerChannel;
+	return ctx->pendingCount + swr_get_out_samples(ctx->ctx, inSampleCountPerChannel);
 }
 
 int SoundResampler_Resample(
@@ -81,13 +327,75 @@ int SoundResampler_Resample(
 )
 {
 	InternalState* ctx = (InternalState*)context;
+	if (ctx->convert)
+	{
+		return SoundResampler_Convert(
+			ctx, inSoundData, inSampleCountPerChannel, outSoundData, outSampleCountPerChannel
+		);
+	}
+	if (ctx->pendingCount > 0)
+	{
+		return SoundResampler_ConvertAfterPending(
+			ctx, inSoundData, inSampleCountPerChannel, outSoundData, outSampleCountPerChannel
+		);
+	}
 	return swr_convert(ctx->ctx, outSoundData, outSampleCountPerChannel, inSoundData, inSampleCountPerChannel);
 }
 
-void SoundResampler_ReleaseContext(SoundResamplerContext** context)
+int SoundResampler_Drain(SoundResamplerContext* context, uint8_t** outSoundData, int outSampleCountPerChannel)
 {
 	InternalState* ctx = (InternalState*)context;
+	if (ctx->convert)
+		return SoundResampler_TakePending(ctx, outSoundData, outSampleCountPerChannel);
+	if (!ctx->ctx)
+		return 0;
+
+	// input must not be NULL, otherwise swresample would flush its filter. one pointer for every possible channel
+	static const uint8_t* noInput[64] = {NULL};
+	if (ctx->pendingCount > 0)
+		return SoundResampler_ConvertAfterPending(ctx, noInput, 0, outSoundData, outSampleCountPerChannel);
+	return swr_convert(ctx->ctx, outSoundData, outSampleCountPerChannel, noInput, 0);
+}
+
+int SoundResampler_Flush(SoundResamplerContext* context, uint8_t** outSoundData, int outSampleCountPerChannel)
+{
+	InternalState* ctx = (InternalState*)context;
+	if (ctx->convert)
+		return SoundResampler_TakePending(ctx, outSoundData, outSampleCountPerChannel);
+	if (!ctx->ctx)
+		return 0;
+
+	if (ctx->pendingCount > 0)
+		return SoundResampler_ConvertAfterPending(ctx, NULL, 0, outSoundData, outSampleCountPerChannel);
+	return swr_convert(ctx->ctx, outSoundData, outSampleCountPerChannel, NULL, 0);
+}
+
+int64_t SoundResampler_GetDelay(SoundResamplerContext* context)
+{
+	InternalState* ctx = (InternalState*)context;
+	if (ctx->convert)
+		return ctx->pendingCount;
+	if (!ctx->ctx)
+		return 0;
+
+	return ctx->pendingCount + swr_get_delay(ctx->ctx, ctx->cacheOutSampleRate);
+}
+
+void SoundResampler_Reset(SoundResamplerContext* context)
+{
+	// context is created again by next SoundResampler_SetParameters call
+	InternalState* ctx = (InternalState*)context;
+	swr_free(&ctx->ctx);
+	ctx->convert = NULL;
+	ctx->pendingStart = 0;
+	ctx->pendingCount = 0;
+}
+
+void SoundResampler_ReleaseContext(SoundResamplerContext** context)
+{
+	InternalState* ctx = (InternalState*)*context;
 	swr_free(&ctx->ctx);
-	free(ctx);
+	Allocator_Free(ctx->pendingBuffer);
+	Allocator_Free(ctx);
 	*context = NULL;
 }
@@ -18,6 +18,9 @@ extern "C"
 		enum MediaDecoderSampleFormat outFormat
 	);
 
+	/// @brief Select filter, samples buffered with previous filter are still returned before new ones
+	void SoundResampler_SetQuality(SoundResamplerContext* context, enum MediaDecoderResampleQuality quality);
+
 	int SoundResampler_FindMaxOutputSamples(SoundResamplerContext* context, int inSampleCountPerChannel);
 
 	int SoundResampler_Resample(
@@ -25,6 +28,18 @@ extern "C"
 		uint8_t** outSoundData, int outSampleCountPerChannel
 	);
 
+	/// @brief Write samples that resampler buffered in previous calls, without adding new input
+	int SoundResampler_Drain(SoundResamplerContext* context, uint8_t** outSoundData, int outSampleCountPerChannel);
+
+	/// @brief Write all remaining samples at end of stream, including ones held back by resampling filter
+	int SoundResampler_Flush(SoundResamplerContext* context, uint8_t** outSoundData, int outSampleCountPerChannel);
+
+	/// @brief Get number of output samples per channel that were passed in, but not yet returned
+	int64_t SoundResampler_GetDelay(SoundResamplerContext* context);
+
+	/// @brief Drop all buffered samples, for example after seeking
+	void SoundResampler_Reset(SoundResamplerContext* context);
+
 	void SoundResampler_ReleaseContext(SoundResamplerContext** context);
 #ifdef __cplusplus
 }
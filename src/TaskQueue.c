@@ -0,0 +1,116 @@
+#include "TaskQueue.h"
+
+#include "Allocator.h"
+#include <libavutil/cpu.h>
+#include <threads.h>
+
+// tasks are mostly waiting for disk or network, so more workers than cores are useful
+#define MIN_WORKER_COUNT 4
+#define MAX_WORKER_COUNT 16
+
+typedef struct Task
+{
+	TaskFunction function;
+	void* arg;
+	struct Task* next;
+} Task;
+
+typedef struct
+{
+	mtx_t lock;
+	cnd_t taskAdded;
+	Task* first;
+	Task* last;
+	int taskCount;
+	int workerCount;
+	int idleWorkerCount;
+	int maxWorkerCount;
+} TaskQueue;
+
+static TaskQueue queue;
+static once_flag queueInitFlag = ONCE_FLAG_INIT;
+
+static void TaskQueue_Init()
+{
+	mtx_init(&queue.lock, mtx_plain);
+	cnd_init(&queue.taskAdded);
+
+	queue.maxWorkerCount = av_cpu_count() * 2;
+	if (queue.maxWorkerCount < MIN_WORKER_COUNT)
+		queue.maxWorkerCount = MIN_WORKER_COUNT;
+	if (queue.maxWorkerCount > MAX_WORKER_COUNT)
+		queue.maxWorkerCount = MAX_WORKER_COUNT;
+}
+
+static int TaskQueue_Worker(void* arg)
+{
+	mtx_lock(&queue.lock);
+	for (;;)
+	{
+		while (!queue.first)
+		{
+			queue.idleWorkerCount++;
+			cnd_wait(&queue.taskAdded, &queue.lock);
+			queue.idleWorkerCount--;
+		}
+
+		Task* task = queue.first;
+		queue.first = task->next;
+		if (!queue.first)
+			queue.last = NULL;
+		queue.taskCount--;
+		mtx_unlock(&queue.lock);
+
+		task->function(task->arg);
+		Allocator_Free(task);
+
+		mtx_lock(&queue.lock);
+	}
+	return 0;
+}
+
+int TaskQueue_Push(TaskFunction function, void* arg)
+{
+	call_once(&queueInitFlag, &TaskQueue_Init);
+
+	Task* task = Allocator_Alloc(sizeof(*task));
+	if (!task)
+		return -1;
+	task->function = function;
+	task->arg = arg;
+	task->next = NULL;
+
+	mtx_lock(&queue.lock);
+	if (queue.last)
+		queue.last->next = task;
+	else
+		queue.first = task;
+	queue.last = task;
+	queue.taskCount++;
+
+	// workers live as long as process, new ones are only started when waiting tasks outnumber idle workers
+	if (queue.taskCount > queue.idleWorkerCount && queue.workerCount < queue.maxWorkerCount)
+	{
+		thrd_t thread;
+		if (thrd_create(&thread, &TaskQueue_Worker, NULL) == thrd_success)
+		{
+			thrd_detach(thread);
+			queue.workerCount++;
+		}
+	}
+
+	int ret = queue.workerCount > 0 ? 0 : -1;
+	if (ret)
+	{
+		// no thread could be started, task would never run
+		queue.first = queue.last = NULL;
+		queue.taskCount = 0;
+		Allocator_Free(task);
+	}
+	else
+	{
+		cnd_signal(&queue.taskAdded);
+	}
+	mtx_unlock(&queue.lock);
+	return ret;
+}
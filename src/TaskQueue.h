@@ -0,0 +1,14 @@
+#pragma once
+
+typedef void (*TaskFunction)(void* arg);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+	/// @brief Run function on process wide pool of worker threads, threads are started when they are first needed
+	/// @return 0 if task was queued, -1 on error
+	int TaskQueue_Push(TaskFunction function, void* arg);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,77 @@
+#include "TensorConverter.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TENSOR_CONVERTER_SSE2
+#include <emmintrin.h>
+#endif
+
+void TensorConverter_NormalizePlanar(
+	const uint8_t* in, float* out, size_t planeSize, const float* scale, const float* bias
+)
+{
+	for (int c = 0; c < 3; c++)
+	{
+		const uint8_t* src = in + c * planeSize;
+		float* dst = out + c * planeSize;
+		size_t i = 0;
+
+#ifdef TENSOR_CONVERTER_SSE2
+		// 16 samples per iteration, widened to 32bit integers and then converted to float
+		const __m128i zero = _mm_setzero_si128();
+		const __m128 s = _mm_set1_ps(scale[c]);
+		const __m128 b = _mm_set1_ps(bias[c]);
+		for (; i + 16 <= planeSize; i += 16)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+			__m128i lo = _mm_unpacklo_epi8(v, zero);
+			__m128i hi = _mm_unpackhi_epi8(v, zero);
+			__m128 f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+			__m128 f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+			__m128 f2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+			__m128 f3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+			_mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(f0, s), b));
+			_mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_mul_ps(f1, s), b));
+			_mm_storeu_ps(dst + i + 8, _mm_add_ps(_mm_mul_ps(f2, s), b));
+			_mm_storeu_ps(dst + i + 12, _mm_add_ps(_mm_mul_ps(f3, s), b));
+		}
+#endif
+
+		for (; i < planeSize; i++)
+			dst[i] = src[i] * scale[c] + bias[c];
+	}
+}
+
+void TensorConverter_NormalizeInterleaved(
+	const uint8_t* in, float* out, size_t pixelCount, const float* scale, const float* bias
+)
+{
+	size_t count = pixelCount * 3;
+	size_t i = 0;
+
+#ifdef TENSOR_CONVERTER_SSE2
+	// 4 pixels per iteration, channel pattern repeats every 12 samples. 16 bytes are loaded, so that last 4 bytes
+	// must still be inside input
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 s0 = _mm_setr_ps(scale[0], scale[1], scale[2], scale[0]);
+	const __m128 s1 = _mm_setr_ps(scale[1], scale[2], scale[0], scale[1]);
+	const __m128 s2 = _mm_setr_ps(scale[2], scale[0], scale[1], scale[2]);
+	const __m128 b0 = _mm_setr_ps(bias[0], bias[1], bias[2], bias[0]);
+	const __m128 b1 = _mm_setr_ps(bias[1], bias[2], bias[0], bias[1]);
+	const __m128 b2 = _mm_setr_ps(bias[2], bias[0], bias[1], bias[2]);
+	for (; i + 16 <= count; i += 12)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+		__m128i lo = _mm_unpacklo_epi8(v, zero);
+		__m128i hi = _mm_unpackhi_epi8(v, zero);
+		__m128 f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+		__m128 f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+		__m128 f2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(f0, s0), b0));
+		_mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(f1, s1), b1));
+		_mm_storeu_ps(out + i + 8, _mm_add_ps(_mm_mul_ps(f2, s2), b2));
+	}
+#endif
+
+	for (; i < count; i++)
+		out[i] = in[i] * scale[i % 3] + bias[i % 3];
+}
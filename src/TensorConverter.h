@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+	/// @brief Convert 3 planes of 8bit samples to float, out = in * scale[plane] + bias[plane]
+	void TensorConverter_NormalizePlanar(
+		const uint8_t* in, float* out, size_t planeSize, const float* scale, const float* bias
+	);
+
+	/// @brief Convert interleaved 3 channel 8bit pixels to float, out = in * scale[channel] + bias[channel]
+	void TensorConverter_NormalizeInterleaved(
+		const uint8_t* in, float* out, size_t pixelCount, const float* scale, const float* bias
+	);
+#ifdef __cplusplus
+}
+#endif